@@ -0,0 +1,1724 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  AsyncIO.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the asynchronous I/O layer. Requests are
+             carried out either by io_uring, when the kernel supports it, or by
+             a pool of threads making blocking calls. The IOEngine class hides
+             which one is in use and adds helpers for reading, appending and
+             rewriting whole files in large overlapped chunks.
+#############################################################################*/
+#include<cerrno>
+#include<chrono>
+#include<cstring>
+#include<cstdlib>
+#include<sstream>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+#include "AsyncIO.h"
+
+#ifdef ASYNCIO_HAVE_URING
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<linux/io_uring.h>
+#endif
+
+/* Sizes used by the I/O layer */
+static const int IO_THREADS = 4;            /* workers of the thread pool */
+static const unsigned URING_ENTRIES = 64;   /* depth of the io_uring queue */
+static const int URING_WAKE_ATTEMPTS = 8;   /* tries at waking its completion
+                                               thread on shutdown */
+static const size_t IO_CHUNK = 1 << 20;     /* largest single transfer made by
+                                               the whole file helpers */
+static const size_t STREAM_DEPTH = 8;       /* blocks a StreamWriter keeps in
+                                               flight */
+static const size_t READ_BLOCK = 4 << 20;   /* block size of a StreamReader */
+static const size_t READ_ALIGNMENT = 4096;  /* alignment of its buffers */
+
+/*-----------------------------------------------------------------------------
+Name:        completeRequest
+
+Description: Mark a request as finished.
+
+Algorithm:   Stores the result under the request's lock, sets done and wakes
+             anyone waiting on it.
+
+Parameters:  request: the request that finished
+             result:  bytes transfered or -errno
+
+Output:      void
+
+Result:      Waiters on the request are released.
+------------------------------------------------------------------------------*/
+static void completeRequest(IORequest *request, long result)
+{
+   lock_guard<mutex> guard(request->lock);
+
+   request->result = result;
+   request->done = true;
+   request->finished.notify_all();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ThreadPoolBackend
+
+Description: Constructor.
+
+Algorithm:   Starts the requested amount of worker threads.
+
+Parameters:  threads: amount of workers
+
+Output:      none
+
+Result:      Workers are waiting for requests.
+------------------------------------------------------------------------------*/
+ThreadPoolBackend :: ThreadPoolBackend(int threads) : stopping(false)
+{
+   for(int worker = 0; worker < threads; worker++)
+      workers.push_back(thread(&ThreadPoolBackend :: work, this));
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~ThreadPoolBackend
+
+Description: Destructor.
+
+Algorithm:   Sets stopping, wakes every worker and joins them. Workers finish
+             the requests still queued before they exit.
+
+Parameters:  none
+
+Output:      none
+
+Result:      All workers have exited.
+------------------------------------------------------------------------------*/
+ThreadPoolBackend :: ~ThreadPoolBackend()
+{
+   {
+      lock_guard<mutex> guard(lock);
+      stopping = true;
+   }
+   pending.notify_all();
+
+   for(size_t worker = 0; worker < workers.size(); worker++)
+      workers[worker].join();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        work
+
+Description: Loop run by every worker.
+
+Algorithm:   Waits for a request, then carries it out with pread or pwrite. A
+             write with a negative offset uses write so it lands at the end of
+             a file opened for appending. Calls interrupted by a signal are
+             retried.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Requests are completed until the backend stops.
+------------------------------------------------------------------------------*/
+void ThreadPoolBackend :: work(void)
+{
+   for(;;)
+   {
+      IOTicket request; /* request taken off the queue */
+      ssize_t moved;    /* bytes transfered */
+
+      {
+         unique_lock<mutex> guard(lock);
+         while(queue.empty() && !stopping)
+            pending.wait(guard);
+         if(queue.empty())
+            return;
+         request = queue.front();
+         queue.pop_front();
+      }
+
+      char *base = static_cast<char *>(request->vector.iov_base);
+      size_t length = request->vector.iov_len;
+
+      do
+      {
+         if(!request->isWrite)
+            moved = pread(request->fd, base, length, request->offset);
+         else if(request->offset < 0)
+            moved = ::write(request->fd, base, length);
+         else
+            moved = pwrite(request->fd, base, length, request->offset);
+      }
+      while(moved < 0 && errno == EINTR);
+
+      completeRequest(request.get(), moved < 0 ? -errno : moved);
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        submit
+
+Description: Queue a request for the workers.
+
+Algorithm:   Appends the request to the queue and wakes one worker.
+
+Parameters:  request: the request to carry out
+
+Output:      void
+
+Result:      The request will be carried out by a worker.
+------------------------------------------------------------------------------*/
+void ThreadPoolBackend :: submit(IOTicket request)
+{
+   {
+      lock_guard<mutex> guard(lock);
+      queue.push_back(request);
+   }
+   pending.notify_one();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        wait
+
+Description: Block until a request has completed.
+
+Algorithm:   Waits on the request's condition variable until done is set.
+
+Parameters:  request: the request to wait for
+
+Output:      void
+
+Result:      The request has completed.
+------------------------------------------------------------------------------*/
+void ThreadPoolBackend :: wait(IOTicket request)
+{
+   unique_lock<mutex> guard(request->lock);
+   while(!request->done)
+      request->finished.wait(guard);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        name
+
+Description: Name of the backend.
+
+Algorithm:   Returns a literal.
+
+Parameters:  none
+
+Output:      "thread pool"
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+const char * ThreadPoolBackend :: name(void) const
+{
+   return "thread pool";
+}
+
+#ifdef ASYNCIO_HAVE_URING
+/*-----------------------------------------------------------------------------
+Name:        UringBackend
+
+Description: Constructor.
+
+Algorithm:   Asks the kernel for a ring of the requested depth and maps its
+             submission queue, completion queue and submission entries. Kernels
+             that share one mapping for both queues are handled. If anything
+             fails ringFd is left at -1 so that isReady reports false.
+             Otherwise the completion thread is started.
+
+Parameters:  depth: amount of submission queue entries to ask for
+
+Output:      none
+
+Result:      The ring is set up, or isReady is false.
+------------------------------------------------------------------------------*/
+UringBackend :: UringBackend(unsigned depth) :
+                ringFd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED),
+                sqes(MAP_FAILED), sqRingSize(0), cqRingSize(0), sqesSize(0),
+                entries(0), stopping(false)
+{
+   struct io_uring_params params; /* filled in by the kernel */
+   bool singleMap;                /* both queues share one mapping */
+
+   memset(&params, 0, sizeof(params));
+   ringFd = syscall(__NR_io_uring_setup, depth, &params);
+   if(ringFd < 0)
+   {
+      ringFd = -1;
+      return;
+   }
+
+   /* Map the rings */
+   singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+   sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+   cqRingSize = params.cq_off.cqes +
+                params.cq_entries * sizeof(struct io_uring_cqe);
+   if(singleMap)
+   {
+      if(cqRingSize > sqRingSize)
+         sqRingSize = cqRingSize;
+      cqRingSize = sqRingSize;
+   }
+
+   sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+   if(singleMap)
+      cqRing = sqRing;
+   else
+      cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+
+   sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+   sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+   if(sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+   {
+      close(ringFd);
+      ringFd = -1;
+      return;
+   }
+
+   /* Locate the fields of each queue */
+   char *sq = static_cast<char *>(sqRing);
+   char *cq = static_cast<char *>(cqRing);
+
+   sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+   sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+   sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+   sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+   cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+   cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+   cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+   cqes = cq + params.cq_off.cqes;
+   entries = params.sq_entries;
+
+   completer = thread(&UringBackend :: complete, this);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~UringBackend
+
+Description: Destructor.
+
+Algorithm:   Sets stopping and submits an entry that does nothing, which
+             wakes the completion thread; it ends once every request in flight
+             is complete and is joined. A request still in flight wakes it as
+             well, so the entry is only needed when none is. A refused entry
+             is tried again after a millisecond, up to URING_WAKE_ATTEMPTS
+             times. Nothing else ends the kernel wait of a thread blocked on an
+             empty ring, so if every attempt fails the thread is detached and
+             the ring it waits on is left open rather than joining forever.
+             Otherwise unmaps whatever was mapped and closes the ring.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The ring is released.
+------------------------------------------------------------------------------*/
+UringBackend :: ~UringBackend()
+{
+   bool isWoken = false; /* the completion thread will see stopping */
+
+   if(completer.joinable())
+   {
+      for(int attempt = 0; !isWoken && attempt < URING_WAKE_ATTEMPTS;
+          attempt++)
+      {
+         if(attempt > 0)
+            this_thread :: sleep_for(chrono :: milliseconds(1));
+
+         lock_guard<mutex> guard(lock);
+         stopping = true;
+         isWoken = !inFlight.empty() || push(NULL) == 0;
+      }
+
+      if(!isWoken)
+      {
+         completer.detach();
+         return;
+      }
+      completer.join();
+   }
+
+   if(sqes != MAP_FAILED)
+      munmap(sqes, sqesSize);
+   if(cqRing != MAP_FAILED && cqRing != sqRing)
+      munmap(cqRing, cqRingSize);
+   if(sqRing != MAP_FAILED)
+      munmap(sqRing, sqRingSize);
+   if(ringFd >= 0)
+      close(ringFd);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        isReady
+
+Description: Whether the ring could be set up.
+
+Algorithm:   Checks ringFd.
+
+Parameters:  none
+
+Output:      true when the ring is usable
+
+Result:      Status is returned.
+------------------------------------------------------------------------------*/
+bool UringBackend :: isReady(void) const
+{
+   return ringFd >= 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        reap
+
+Description: Complete every request found on the completion queue.
+
+Algorithm:   Walks the completion queue from head to tail, completes the
+             request named by each entry and drops it from inFlight, then
+             publishes the new head to the kernel and wakes submitters waiting
+             for room. An entry naming no request was only sent to wake the
+             completion thread. Must be called with lock held.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The completion queue is empty.
+------------------------------------------------------------------------------*/
+void UringBackend :: reap(void)
+{
+   unsigned head = *cqHead;
+   unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+   while(head != tail)
+   {
+      struct io_uring_cqe *cqe =
+         static_cast<struct io_uring_cqe *>(cqes) + (head & *cqMask);
+      IORequest *request = reinterpret_cast<IORequest *>(cqe->user_data);
+
+      head++;
+      if(request == NULL)
+         continue;
+
+      completeRequest(request, cqe->res);
+      for(size_t slot = 0; slot < inFlight.size(); slot++)
+         if(inFlight[slot].get() == request)
+         {
+            inFlight[slot] = inFlight.back();
+            inFlight.pop_back();
+            break;
+         }
+   }
+
+   if(head != *cqHead)
+   {
+      __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+      room.notify_all();
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        push
+
+Description: Place an entry on the submission queue and hand it to the kernel.
+
+Algorithm:   Fills in a readv or writev entry pointing at the request's iovec,
+             or an entry that does nothing when there is no request. A
+             negative offset is sent as 0, since appends are made on
+             descriptors opened with O_APPEND. If the kernel refuses the entry
+             the tail is rolled back. Must be called with lock held and room on
+             the queue.
+
+Parameters:  request: the request to carry out; NULL for an entry that only
+                      wakes the completion thread
+
+Output:      error: 0, or the errno of a refused entry
+
+Result:      The entry is in flight, or nothing changed.
+------------------------------------------------------------------------------*/
+int UringBackend :: push(IORequest *request)
+{
+   unsigned tail = *sqTail;
+   unsigned index = tail & *sqMask;
+   struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(sqes) + index;
+
+   memset(sqe, 0, sizeof(*sqe));
+   if(request == NULL)
+      sqe->opcode = IORING_OP_NOP;
+   else
+   {
+      sqe->opcode = request->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->fd = request->fd;
+      sqe->addr = reinterpret_cast<unsigned long>(&request->vector);
+      sqe->len = 1;
+      sqe->off = request->offset < 0 ? 0 : request->offset;
+   }
+   sqe->user_data = reinterpret_cast<unsigned long>(request);
+   sqArray[index] = index;
+
+   __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+   for(;;)
+   {
+      long submitted = syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, NULL, 0);
+      if(submitted >= 0)
+         return 0;
+      if(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+      {
+         reap();
+         continue;
+      }
+
+      /* Kernel refused the entry; take it back */
+      int error = errno;
+      __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+      /* Return value */
+      return error;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        submit
+
+Description: Place a request on the submission queue.
+
+Algorithm:   If the queue is full, waits for the completion thread to reap
+             some requests first. The request is then listed in flight and
+             pushed; if the kernel refuses it, it fails.
+
+Parameters:  request: the request to carry out
+
+Output:      void
+
+Result:      The request is in flight, or completed with an error.
+------------------------------------------------------------------------------*/
+void UringBackend :: submit(IOTicket request)
+{
+   unique_lock<mutex> guard(lock);
+   int error; /* errno of a refused request */
+
+   while(inFlight.size() >= entries)
+      room.wait(guard);
+
+   inFlight.push_back(request);
+   error = push(request.get());
+   if(error != 0)
+   {
+      for(size_t slot = 0; slot < inFlight.size(); slot++)
+         if(inFlight[slot] == request)
+         {
+            inFlight[slot] = inFlight.back();
+            inFlight.pop_back();
+            break;
+         }
+      completeRequest(request.get(), -error);
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        wait
+
+Description: Block until a request has completed.
+
+Algorithm:   Waits on the request's condition variable until the completion
+             thread sets done, without taking the backend's lock.
+
+Parameters:  request: the request to wait for
+
+Output:      void
+
+Result:      The request has completed.
+------------------------------------------------------------------------------*/
+void UringBackend :: wait(IOTicket request)
+{
+   unique_lock<mutex> guard(request->lock);
+   while(!request->done)
+      request->finished.wait(guard);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        complete
+
+Description: Loop run by the completion thread.
+
+Algorithm:   Asks the kernel, without holding the lock, to wait for at least
+             one completion, then reaps the completion queue under the lock.
+             Being the only thread that waits on the queue, it never sleeps
+             on a completion another thread took. Ends once stopping is set
+             and no request is in flight.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Requests are completed until the backend stops.
+------------------------------------------------------------------------------*/
+void UringBackend :: complete(void)
+{
+   unique_lock<mutex> guard(lock);
+
+   while(!stopping || !inFlight.empty())
+   {
+      guard.unlock();
+      syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+              NULL, 0);
+      guard.lock();
+      reap();
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        name
+
+Description: Name of the backend.
+
+Algorithm:   Returns a literal.
+
+Parameters:  none
+
+Output:      "io_uring"
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+const char * UringBackend :: name(void) const
+{
+   return "io_uring";
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+Name:        IOEngine
+
+Description: Constructor.
+
+Algorithm:   Tries to set up io_uring and keeps it if the kernel accepts the
+             ring. Otherwise the thread pool is used.
+
+Parameters:  none
+
+Output:      none
+
+Result:      A backend is ready for requests.
+------------------------------------------------------------------------------*/
+IOEngine :: IOEngine() : backend(NULL), commitSync(false), scans(0),
+                          scanBytes(0), scanSeconds(0), lastBytes(0),
+                          lastSeconds(0), lastWaiting(0)
+{
+#ifdef ASYNCIO_HAVE_URING
+   UringBackend *uring = new UringBackend(URING_ENTRIES);
+
+   if(uring->isReady())
+      backend = uring;
+   else
+      delete uring;
+#endif
+
+   if(backend == NULL)
+      backend = new ThreadPoolBackend(IO_THREADS);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~IOEngine
+
+Description: Destructor.
+
+Algorithm:   Deletes the backend.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Backend resources are released.
+------------------------------------------------------------------------------*/
+IOEngine :: ~IOEngine()
+{
+   delete backend;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        read
+
+Description: Submit a read of a file region.
+
+Algorithm:   Builds a request and gives it to the backend without waiting.
+
+Parameters:  fd:     file to read
+             buffer: where to place the data; must stay valid until waited on
+             length: amount of bytes to read
+             offset: file offset to read from
+
+Output:      ticket: handle to pass to wait
+
+Result:      The read is in progress.
+------------------------------------------------------------------------------*/
+IOTicket IOEngine :: read(int fd, char *buffer, size_t length, off_t offset)
+{
+   IOTicket request = make_shared<IORequest>();
+
+   request->fd = fd;
+   request->vector.iov_base = buffer;
+   request->vector.iov_len = length;
+   request->offset = offset;
+   request->isWrite = false;
+   request->result = 0;
+   request->done = false;
+
+   backend->submit(request);
+
+   return request;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        write
+
+Description: Submit a write of a file region.
+
+Algorithm:   Builds a request and gives it to the backend without waiting.
+
+Parameters:  fd:     file to write
+             buffer: data to write; must stay valid until waited on
+             length: amount of bytes to write
+             offset: file offset to write at; -1 appends to a file opened with
+                     O_APPEND
+
+Output:      ticket: handle to pass to wait
+
+Result:      The write is in progress.
+------------------------------------------------------------------------------*/
+IOTicket IOEngine :: write(int fd, const char *buffer, size_t length,
+                           off_t offset)
+{
+   IOTicket request = make_shared<IORequest>();
+
+   request->fd = fd;
+   request->vector.iov_base = const_cast<char *>(buffer);
+   request->vector.iov_len = length;
+   request->offset = offset;
+   request->isWrite = true;
+   request->result = 0;
+   request->done = false;
+
+   backend->submit(request);
+
+   return request;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        wait
+
+Description: Block until a request has completed.
+
+Algorithm:   Lets the backend wait and returns the stored result.
+
+Parameters:  request: ticket returned by read or write
+
+Output:      result: bytes transfered, or -errno on failure
+
+Result:      The request has completed.
+------------------------------------------------------------------------------*/
+long IOEngine :: wait(IOTicket request)
+{
+   backend->wait(request);
+
+   return request->result;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readFile
+
+Description: Read a whole file.
+
+Algorithm:   The file is sized with fstat and read with readPrefix. A missing
+             file reads as empty.
+
+Parameters:  path: file to read
+
+Output:      content: contents of the file
+
+Result:      The file contents are returned.
+------------------------------------------------------------------------------*/
+string IOEngine :: readFile(const string &path)
+{
+   string content;   /* contents of the file */
+   struct stat info; /* size of the file */
+
+   int fd = open(path.c_str(), O_RDONLY);
+   if(fd < 0)
+      return content;
+
+   if(fstat(fd, &info) == 0)
+      content = readPrefix(fd, info.st_size);
+   close(fd);
+
+   return content;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readPrefix
+
+Description: Read the first bytes of an open file.
+
+Algorithm:   Reads the range starting at offset 0.
+
+Parameters:  fd:     file to read
+             length: amount of bytes to read from the start of the file
+
+Output:      content: the bytes read
+
+Result:      Up to length bytes of the file are returned.
+------------------------------------------------------------------------------*/
+string IOEngine :: readPrefix(int fd, size_t length)
+{
+   return readRange(fd, 0, length);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readRange
+
+Description: Read a range of an open file.
+
+Algorithm:   A read is submitted for every chunk at once so that the backend
+             can overlap them. Every read is waited on before the buffer is
+             trimmed at the first short read.
+
+Parameters:  fd:     file to read
+             start:  offset of the first byte
+             length: amount of bytes to read
+
+Output:      content: the bytes read
+
+Result:      Up to length bytes of the file are returned.
+------------------------------------------------------------------------------*/
+string IOEngine :: readRange(int fd, off_t start, size_t length)
+{
+   string content;           /* bytes of the file */
+   vector<IOTicket> tickets; /* one read per chunk */
+   size_t valid;             /* bytes actually read */
+
+   /* Submit every chunk before waiting on any of them */
+   content.resize(length);
+   for(size_t offset = 0; offset < content.size(); offset += IO_CHUNK)
+   {
+      size_t chunk = content.size() - offset;
+      if(chunk > IO_CHUNK)
+         chunk = IO_CHUNK;
+      tickets.push_back(read(fd, &content[offset], chunk, start + offset));
+   }
+
+   /* Keep everything up to the first short read */
+   valid = content.size();
+   for(size_t chunk = 0; chunk < tickets.size(); chunk++)
+   {
+      long got = wait(tickets[chunk]);
+      size_t end = chunk * IO_CHUNK + (got > 0 ? got : 0);
+
+      if(got < static_cast<long>(tickets[chunk]->vector.iov_len) &&
+         end < valid)
+         valid = end;
+   }
+
+   content.resize(valid);
+
+   return content;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        appendFile
+
+Description: Append data to the end of a file.
+
+Algorithm:   Opens the file for appending, creating it if needed, and submits
+             writes until everything has been written.
+
+Parameters:  path: file to append to
+             data: bytes to append
+
+Output:      true when all the data was written
+
+Result:      The file is extended with data.
+------------------------------------------------------------------------------*/
+bool IOEngine :: appendFile(const string &path, const string &data)
+{
+   size_t written = 0; /* bytes written so far */
+
+   int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+   if(fd < 0)
+      return false;
+
+   while(written < data.size())
+   {
+      long moved = wait(write(fd, data.data() + written, data.size() - written,
+                              -1));
+      if(moved <= 0)
+         break;
+      written += moved;
+   }
+
+   close(fd);
+
+   return written == data.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        writeFile
+
+Description: Replace the contents of a file.
+
+Algorithm:   Opens the file truncated, creating it if needed, and submits a
+             write for every chunk at once. Short writes are finished off one
+             at a time.
+
+Parameters:  path: file to write
+             data: new contents
+
+Output:      true when all the data was written
+
+Result:      The file holds exactly data.
+------------------------------------------------------------------------------*/
+bool IOEngine :: writeFile(const string &path, const string &data)
+{
+   vector<IOTicket> tickets; /* one write per chunk */
+   bool complete = true;     /* every byte was written */
+
+   int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if(fd < 0)
+      return false;
+
+   for(size_t offset = 0; offset < data.size(); offset += IO_CHUNK)
+   {
+      size_t length = data.size() - offset;
+      if(length > IO_CHUNK)
+         length = IO_CHUNK;
+      tickets.push_back(write(fd, data.data() + offset, length, offset));
+   }
+
+   for(size_t chunk = 0; chunk < tickets.size(); chunk++)
+   {
+      size_t offset = chunk * IO_CHUNK;
+      size_t length = tickets[chunk]->vector.iov_len;
+      long moved = wait(tickets[chunk]);
+
+      /* Finish a short write in place */
+      while(moved >= 0 && static_cast<size_t>(moved) < length)
+      {
+         offset += moved;
+         length -= moved;
+         moved = wait(write(fd, data.data() + offset, length, offset));
+         if(moved == 0)
+            moved = -1;
+      }
+
+      if(moved < 0)
+         complete = false;
+   }
+
+   close(fd);
+
+   return complete;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        syncFile
+
+Description: Make a file's contents durable.
+
+Algorithm:   Opens the file and flushes it to the device with fsync. A
+             directory is flushed the same way, which makes the names renamed
+             into it durable.
+
+Parameters:  path: file or directory to flush
+
+Output:      true when the file is on the device
+
+Result:      A power loss no longer loses what was written to path.
+------------------------------------------------------------------------------*/
+bool IOEngine :: syncFile(const string &path)
+{
+   int fd = open(path.c_str(), O_RDONLY); /* the file to flush */
+   bool isSynced;                         /* result */
+
+   if(fd < 0)
+      return false;
+
+   while(!(isSynced = fsync(fd) == 0) && errno == EINTR)
+      ;
+   close(fd);
+
+   /* Return value */
+   return isSynced;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        setCommitSync
+
+Description: Choose whether every commit is flushed to the device.
+
+Algorithm:   Assigns commitSync.
+
+Parameters:  isSynced: true to flush every commit
+
+Output:      void
+
+Result:      Engines follow the new policy from their next commit on.
+------------------------------------------------------------------------------*/
+void IOEngine :: setCommitSync(bool isSynced)
+{
+   commitSync = isSynced;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getCommitSync
+
+Description: Whether every commit is flushed to the device.
+
+Algorithm:   Returns commitSync.
+
+Parameters:  none
+
+Output:      commitSync: the policy
+
+Result:      The policy is returned.
+------------------------------------------------------------------------------*/
+bool IOEngine :: getCommitSync(void) const
+{
+   return commitSync;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        backendName
+
+Description: Name of the backend in use.
+
+Algorithm:   Asks the backend.
+
+Parameters:  none
+
+Output:      "io_uring" or "thread pool"
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+const char * IOEngine :: backendName(void) const
+{
+   return backend->name();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        noteScan
+
+Description: Record a sequential pass.
+
+Algorithm:   Adds the pass to the totals and keeps it as the last one.
+
+Parameters:  length:  bytes read
+             seconds: time from opening the range to closing it
+             waited:  part of that time spent waiting on reads
+
+Output:      void
+
+Result:      The pass is part of the metrics.
+------------------------------------------------------------------------------*/
+void IOEngine :: noteScan(long long length, double seconds, double waited)
+{
+   lock_guard<mutex> guard(statsLock);
+
+   scans++;
+   scanBytes += length;
+   scanSeconds += seconds;
+   lastBytes = length;
+   lastSeconds = seconds;
+   lastWaiting = waited;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        describeScans
+
+Description: Throughput of sequential passes for the (s)Stats command.
+
+Algorithm:   Reports the passes made, the MB/s over all of them and the MB/s
+             of the last one with the share of its time spent waiting on
+             reads. A pass that mostly waits is limited by the device; one that
+             rarely waits is limited by the parsing.
+
+Parameters:  none
+
+Output:      text: one line of metrics
+
+Result:      Text is returned.
+------------------------------------------------------------------------------*/
+string IOEngine :: describeScans(void) const
+{
+   lock_guard<mutex> guard(statsLock);
+   ostringstream text; /* the metrics */
+
+   text << "Sequential scans: " << scans << " pass(es), "
+        << scanBytes / 1e6 << " MB";
+   if(scanSeconds > 0)
+      text << " at " << scanBytes / 1e6 / scanSeconds << " MB/s";
+   if(lastSeconds > 0)
+      text << "; last " << lastBytes / 1e6 << " MB at "
+           << lastBytes / 1e6 / lastSeconds << " MB/s, "
+           << lastWaiting * 100 / lastSeconds << "% waiting on reads";
+   text << ".";
+
+   /* Return value */
+   return text.str();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        StreamWriter
+
+Description: Constructor.
+
+Algorithm:   Starts with no file open.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The writer is ready to open a file.
+------------------------------------------------------------------------------*/
+StreamWriter :: StreamWriter() : fd(-1), offset(0), failed(false)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~StreamWriter
+
+Description: Destructor.
+
+Algorithm:   Closes a file that was left open so no block is abandoned while
+             the engine still points at it.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The file is closed.
+------------------------------------------------------------------------------*/
+StreamWriter :: ~StreamWriter()
+{
+   if(fd >= 0)
+      close();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Create or truncate the file to write.
+
+Algorithm:   Opens the file for writing and resets the stream state.
+
+Parameters:  path: file to write
+
+Output:      true when the file could be opened
+
+Result:      The stream writes to the start of path.
+------------------------------------------------------------------------------*/
+bool StreamWriter :: open(const string &path)
+{
+   if(fd >= 0)
+      close();
+
+   fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   offset = 0;
+   failed = false;
+   buffer.clear();
+   buffer.reserve(IO_CHUNK);
+
+   return fd >= 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        openAppend
+
+Description: Open a file to write after its current end.
+
+Algorithm:   Opens the file for writing, creating it if needed, and starts the
+             stream at its current size. Blocks are written at explicit
+             offsets rather than with O_APPEND so that blocks in flight
+             together still land in the order they were written.
+
+Parameters:  path: file to extend
+
+Output:      true when the file could be opened
+
+Result:      The stream writes after the end of path.
+------------------------------------------------------------------------------*/
+bool StreamWriter :: openAppend(const string &path)
+{
+   struct stat info; /* size of the file */
+
+   if(fd >= 0)
+      close();
+
+   fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+   offset = 0;
+   failed = false;
+   buffer.clear();
+   buffer.reserve(IO_CHUNK);
+
+   if(fd >= 0 && fstat(fd, &info) == 0)
+      offset = info.st_size;
+
+   return fd >= 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        retire
+
+Description: Wait for the oldest block in flight.
+
+Algorithm:   Waits on the block and finishes a short write in place. A failed
+             write sets failed.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The oldest block is on disk and released.
+------------------------------------------------------------------------------*/
+void StreamWriter :: retire(void)
+{
+   IOTicket request = inFlight.front().first;
+   shared_ptr<string> block = inFlight.front().second;
+   size_t length = request->vector.iov_len;
+   off_t at = request->offset;
+   long moved = ioEngine().wait(request);
+
+   while(moved >= 0 && static_cast<size_t>(moved) < length)
+   {
+      at += moved;
+      length -= moved;
+      moved = ioEngine().wait(ioEngine().write(fd,
+                 block->data() + block->size() - length, length, at));
+      if(moved == 0)
+         moved = -1;
+   }
+
+   if(moved < 0)
+      failed = true;
+
+   inFlight.pop_front();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        submitBuffer
+
+Description: Hand the current block to the engine.
+
+Algorithm:   Makes room if too many blocks are in flight, then moves the
+             buffer into a block that stays alive until it is retired and
+             submits it at the current offset.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The block is being written and buffer is empty.
+------------------------------------------------------------------------------*/
+void StreamWriter :: submitBuffer(void)
+{
+   if(buffer.empty())
+      return;
+
+   while(inFlight.size() >= STREAM_DEPTH)
+      retire();
+
+   shared_ptr<string> block = make_shared<string>();
+   block->swap(buffer);
+   buffer.reserve(IO_CHUNK);
+
+   IOTicket request = ioEngine().write(fd, block->data(), block->size(),
+                                       offset);
+   offset += block->size();
+   inFlight.push_back(make_pair(request, block));
+}
+
+/*-----------------------------------------------------------------------------
+Name:        write
+
+Description: Add bytes to the stream.
+
+Algorithm:   Copies the bytes into the current block and submits the block
+             each time it fills.
+
+Parameters:  data:   bytes to add
+             length: amount of bytes
+
+Output:      void
+
+Result:      The bytes will be written in order.
+------------------------------------------------------------------------------*/
+void StreamWriter :: write(const char *data, size_t length)
+{
+   while(length > 0)
+   {
+      size_t room = IO_CHUNK - buffer.size();
+      if(room > length)
+         room = length;
+
+      buffer.append(data, room);
+      data += room;
+      length -= room;
+
+      if(buffer.size() >= IO_CHUNK)
+         submitBuffer();
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        write
+
+Description: Add a string to the stream.
+
+Algorithm:   Forwards to the byte version.
+
+Parameters:  data: bytes to add
+
+Output:      void
+
+Result:      The bytes will be written in order.
+------------------------------------------------------------------------------*/
+void StreamWriter :: write(const string &data)
+{
+   write(data.data(), data.size());
+}
+
+/*-----------------------------------------------------------------------------
+Name:        close
+
+Description: Finish the file.
+
+Algorithm:   Submits the partly filled block, waits for every block, syncs the
+             data to disk and closes the file.
+
+Parameters:  none
+
+Output:      true when every byte was written
+
+Result:      The file is complete and closed.
+------------------------------------------------------------------------------*/
+bool StreamWriter :: close(void)
+{
+   if(fd < 0)
+      return false;
+
+   submitBuffer();
+   while(!inFlight.empty())
+      retire();
+
+   if(fdatasync(fd) < 0)
+      failed = true;
+   ::close(fd);
+   fd = -1;
+
+   return !failed;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        StreamReader
+
+Description: Constructor.
+
+Algorithm:   Starts with no file open and no buffers.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The reader is ready to open a file.
+------------------------------------------------------------------------------*/
+StreamReader :: StreamReader() : fd(-1), isOwned(false), offset(0), end(0),
+                                 blockBytes(0), capacity(0), current(-1),
+                                 blockOffset(0), restOffset(0), carryOffset(0),
+                                 bytes(0), waiting(0), failed(false)
+{
+   buffers[0] = buffers[1] = NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~StreamReader
+
+Description: Destructor.
+
+Algorithm:   Closes a range left open, so no read still points at a buffer,
+             and frees the buffers.
+
+Parameters:  none
+
+Output:      none
+
+Result:      StreamReader object is deallocated.
+------------------------------------------------------------------------------*/
+StreamReader :: ~StreamReader()
+{
+   if(fd >= 0)
+      close();
+
+   free(buffers[0]);
+   free(buffers[1]);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Start reading a whole file.
+
+Algorithm:   Opens the file and reads its range from 0 to its size. The file is
+             closed by close.
+
+Parameters:  path: file to read
+
+Output:      true when the file could be opened
+
+Result:      The first blocks of path are being read.
+------------------------------------------------------------------------------*/
+bool StreamReader :: open(const string &path)
+{
+   struct stat info; /* size of the file */
+   int opened = ::open(path.c_str(), O_RDONLY);
+
+   if(opened < 0)
+      return false;
+
+   if(fstat(opened, &info) != 0 || !open(opened, 0, info.st_size))
+   {
+      ::close(opened);
+      return false;
+   }
+   isOwned = true;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Start reading a range of an open file.
+
+Algorithm:   Blocks are READ_BLOCK bytes, or the whole range rounded up to
+             READ_ALIGNMENT when it is smaller, so a short range costs little.
+             The two buffers are aligned to READ_ALIGNMENT and kept between
+             ranges when large enough. The kernel is advised the range will be
+             read sequentially, which widens its own read ahead, and a read is
+             submitted into both buffers straight away.
+
+Parameters:  file:  open file to read; left open by close
+             start: offset of the first byte
+             stop:  offset past the last byte
+
+Output:      true when the range could be started
+
+Result:      The first blocks of the range are being read.
+------------------------------------------------------------------------------*/
+bool StreamReader :: open(int file, off_t start, off_t stop)
+{
+   size_t range; /* bytes in the range */
+
+   if(fd >= 0)
+      close();
+   if(file < 0 || start < 0 || stop < start)
+      return false;
+
+   range = stop - start;
+   blockBytes = range < READ_BLOCK ?
+                (range + READ_ALIGNMENT - 1) / READ_ALIGNMENT * READ_ALIGNMENT :
+                READ_BLOCK;
+   if(blockBytes == 0)
+      blockBytes = READ_ALIGNMENT;
+
+   if(capacity < blockBytes)
+   {
+      for(int buffer = 0; buffer < 2; buffer++)
+      {
+         void *block = NULL;
+
+         free(buffers[buffer]);
+         buffers[buffer] = NULL;
+         if(posix_memalign(&block, READ_ALIGNMENT, blockBytes) != 0)
+         {
+            capacity = 0;
+            return false;
+         }
+         buffers[buffer] = static_cast<char *>(block);
+      }
+      capacity = blockBytes;
+   }
+
+   fd = file;
+   isOwned = false;
+   offset = start;
+   end = stop;
+   current = -1;
+   blockOffset = restOffset = carryOffset = start;
+   rest = string_view();
+   carry.clear();
+   bytes = 0;
+   waiting = 0;
+   failed = false;
+   started = chrono :: steady_clock :: now();
+
+   if(range > 0)
+      posix_fadvise(fd, start, range, POSIX_FADV_SEQUENTIAL);
+   submit(0);
+   submit(1);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        submit
+
+Description: Start reading the next block into a buffer.
+
+Algorithm:   Submits a read of up to a block at offset, unless the range is
+             used up.
+
+Parameters:  buffer: the buffer to fill
+
+Output:      void
+
+Result:      The next block is being read.
+------------------------------------------------------------------------------*/
+void StreamReader :: submit(int buffer)
+{
+   size_t length; /* bytes of the block */
+
+   if(offset >= end || failed)
+      return;
+
+   length = end - offset;
+   if(length > blockBytes)
+      length = blockBytes;
+
+   inFlight.push_back(make_pair(ioEngine().read(fd, buffers[buffer], length,
+                                                offset), buffer));
+   offset += length;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        next
+
+Description: The next block.
+
+Algorithm:   The buffer the caller had is given back to the engine with the
+             read of the block after the one in flight, then the oldest read is
+             waited on and the time waiting counted. A short read is finished
+             in place; a read that fails, or finds the file ended early, ends
+             the range.
+
+Parameters:  block: the bytes of the block; valid until the next call
+
+Output:      true when a block was read
+
+Result:      block holds the next bytes of the range.
+------------------------------------------------------------------------------*/
+bool StreamReader :: next(string_view &block)
+{
+   chrono :: steady_clock :: time_point asked; /* when the wait started */
+   size_t length;                              /* bytes asked for */
+   long got,                                   /* bytes read so far */
+        more;                                  /* bytes of a catch up read */
+
+   if(current >= 0)
+   {
+      submit(current);
+      current = -1;
+   }
+   if(inFlight.empty())
+      return false;
+
+   IOTicket request = inFlight.front().first;
+   int buffer = inFlight.front().second;
+   inFlight.pop_front();
+
+   asked = chrono :: steady_clock :: now();
+   length = request->vector.iov_len;
+   got = ioEngine().wait(request);
+   while(got >= 0 && static_cast<size_t>(got) < length)
+   {
+      more = ioEngine().wait(ioEngine().read(fd, buffers[buffer] + got,
+                                             length - got,
+                                             request->offset + got));
+      if(more <= 0)
+         break;
+      got += more;
+   }
+   waiting += chrono :: duration<double>(chrono :: steady_clock :: now() -
+                                         asked).count();
+
+   if(got < 0 || static_cast<size_t>(got) < length)
+   {
+      failed = true;
+      offset = end;
+      if(got <= 0)
+         return false;
+   }
+
+   current = buffer;
+   blockOffset = request->offset;
+   bytes += got;
+   block = string_view(buffers[buffer], got);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        nextRows
+
+Description: The next whole rows.
+
+Algorithm:   The rows of a block up to its last new line are handed out in
+             place. The cut row after them is kept in carry; once the next
+             block arrives, the end of that row is added to it and the joined
+             row handed out on its own before the rest of the block. Bytes
+             after the last new line of the range come last.
+
+Parameters:  rows: one or more rows; valid until the next call
+             at:   file offset of the first row
+
+Output:      true when rows were read
+
+Result:      rows holds the next rows of the range.
+------------------------------------------------------------------------------*/
+bool StreamReader :: nextRows(string_view &rows, off_t &at)
+{
+   string_view block; /* a new block */
+
+   for(;;)
+   {
+      /* Rows left in the current block */
+      if(!rest.empty())
+      {
+         size_t last = rest.rfind('\n');
+
+         if(last == string_view :: npos)
+         {
+            if(carry.empty())
+               carryOffset = restOffset;
+            carry.append(rest.data(), rest.size());
+            rest = string_view();
+            continue;
+         }
+
+         rows = rest.substr(0, last + 1);
+         at = restOffset;
+         carry.assign(rest.data() + last + 1, rest.size() - last - 1);
+         carryOffset = restOffset + last + 1;
+         rest = string_view();
+         return true;
+      }
+
+      /* The end of the range */
+      if(!next(block))
+      {
+         if(carry.empty())
+            return false;
+
+         joined.swap(carry);
+         carry.clear();
+         rows = joined;
+         at = carryOffset;
+         return true;
+      }
+
+      if(carry.empty())
+      {
+         rest = block;
+         restOffset = blockOffset;
+         continue;
+      }
+
+      /* Finish the row cut by the previous block */
+      size_t first = block.find('\n');
+      if(first == string_view :: npos)
+      {
+         carry.append(block.data(), block.size());
+         continue;
+      }
+
+      joined.assign(carry);
+      joined.append(block.data(), first + 1);
+      carry.clear();
+      rest = block.substr(first + 1);
+      restOffset = blockOffset + first + 1;
+      rows = joined;
+      at = carryOffset;
+      return true;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        close
+
+Description: Finish the range.
+
+Algorithm:   Waits for the reads still in flight, since they point at the
+             buffers, records the pass with the engine if it read at least a
+             block and closes the file if the reader opened it.
+
+Parameters:  none
+
+Output:      true when no read failed
+
+Result:      The range is closed.
+------------------------------------------------------------------------------*/
+bool StreamReader :: close(void)
+{
+   if(fd < 0)
+      return false;
+
+   while(!inFlight.empty())
+   {
+      ioEngine().wait(inFlight.front().first);
+      inFlight.pop_front();
+   }
+
+   /* A pass shorter than a block says little about throughput */
+   if(bytes >= static_cast<long long>(READ_BLOCK))
+      ioEngine().noteScan(bytes, chrono :: duration<double>(
+                             chrono :: steady_clock :: now() - started).count(),
+                          waiting);
+
+   if(isOwned)
+      ::close(fd);
+   fd = -1;
+   isOwned = false;
+   current = -1;
+   rest = string_view();
+
+   /* Return value */
+   return !failed;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ioEngine
+
+Description: Engine shared by the whole program.
+
+Algorithm:   Constructs the engine the first time it is asked for.
+
+Parameters:  none
+
+Output:      engine: the shared engine
+
+Result:      The shared engine is returned.
+------------------------------------------------------------------------------*/
+IOEngine & ioEngine(void)
+{
+   static IOEngine engine;
+
+   return engine;
+}
@@ -0,0 +1,415 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  AsyncIO.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definitions of the
+             asynchronous I/O layer used by the database. Reads and writes are
+             submitted as requests and completed later so that a caller can
+             overlap many of them. The kernel's io_uring interface is used when
+             it is available and a pool of worker threads is used otherwise.
+#############################################################################*/
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include<string>
+#include<string_view>
+#include<deque>
+#include<vector>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<condition_variable>
+#include<chrono>
+#include<sys/types.h>
+#include<sys/uio.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNCIO_HAVE_URING
+#endif
+#endif
+
+using namespace std;
+
+/*=============================================================================
+Struct:      IORequest
+
+Description: A single read or write that has been submitted to the I/O layer.
+
+DataFields:  fd:       file descriptor the request operates on
+             vector:   buffer and length of the transfer
+             offset:   file offset of the transfer; -1 appends to the file
+             isWrite:  true for a write, false for a read
+             result:   bytes transfered, or -errno on failure
+             done:     set once the request has completed
+             lock:     guards result and done
+             finished: signaled when done is set
+=============================================================================*/
+struct IORequest
+{
+   int fd;
+   struct iovec vector;
+   off_t offset;
+   bool isWrite;
+
+   long result;
+   bool done;
+   mutex lock;
+   condition_variable finished;
+};
+
+/* Handle held by the caller until the request is waited on */
+typedef shared_ptr<IORequest> IOTicket;
+
+/*=============================================================================
+Class:       IOBackend
+
+Description: Interface implemented by each way of carrying out requests.
+
+Functions:   ~IOBackend: destructor
+             submit:     start a request without waiting for it
+             wait:       block until a request has completed
+             name:       name of the backend for messages
+=============================================================================*/
+class IOBackend
+{
+   public:
+      virtual ~IOBackend() {}
+
+      virtual void submit(IOTicket) = 0;
+      virtual void wait(IOTicket) = 0;
+      virtual const char * name(void) const = 0;
+};
+
+/*=============================================================================
+Class:       ThreadPoolBackend
+
+Description: Carries out requests with blocking pread/pwrite calls made on a
+             fixed set of worker threads.
+
+DataFields:  workers:  threads taking requests off the queue
+             queue:    requests waiting for a worker
+             lock:     guards queue and stopping
+             pending:  signaled when a request is queued
+             stopping: set by the destructor to end the workers
+
+Functions:   ThreadPoolBackend:  constructor; starts the workers
+             ~ThreadPoolBackend: destructor; joins the workers
+             submit:             queue a request
+             wait:               block until a request has completed
+             name:               "thread pool"
+             work:               loop run by every worker
+=============================================================================*/
+class ThreadPoolBackend : public IOBackend
+{
+   private:
+      vector<thread> workers;
+      deque<IOTicket> queue;
+      mutex lock;
+      condition_variable pending;
+      bool stopping;
+
+      void work(void);
+
+   public:
+      ThreadPoolBackend(int);
+      ~ThreadPoolBackend();
+
+      void submit(IOTicket);
+      void wait(IOTicket);
+      const char * name(void) const;
+};
+
+#ifdef ASYNCIO_HAVE_URING
+/*=============================================================================
+Class:       UringBackend
+
+Description: Carries out requests through an io_uring submission and
+             completion queue shared with the kernel. Submitters fill in
+             entries under the lock; a single completion thread sleeps in the
+             kernel until requests finish and completes them, and callers wait
+             on their own request, so no waiter holds up submissions or other
+             waiters.
+
+DataFields:  ringFd:    file descriptor of the ring
+             sqRing:    mapping of the submission queue ring
+             cqRing:    mapping of the completion queue ring
+             sqes:      mapping of the submission queue entries
+             sqRingSize, cqRingSize, sqesSize: sizes of the mappings
+             sqHead, sqTail, sqMask, sqArray: submission queue fields
+             cqHead, cqTail, cqMask, cqes:    completion queue fields
+             entries:   amount of submission queue entries
+             inFlight:  requests submitted but not yet reaped
+             lock:      guards the rings, inFlight and stopping
+             room:      signaled when requests are reaped
+             stopping:  set by the destructor to end the completion thread
+             completer: thread reaping completions
+
+Functions:   UringBackend:  constructor; sets up the ring and starts the
+                            completion thread
+             ~UringBackend: destructor; stops the completion thread, unmaps
+                            and closes the ring
+             isReady:       whether the kernel accepted the ring
+             submit:        place a request on the submission queue
+             wait:          block until a request has completed
+             name:          "io_uring"
+             reap:          complete every request on the completion queue
+             push:          place an entry on the submission queue and hand
+                            it to the kernel
+             complete:      loop run by the completion thread
+=============================================================================*/
+class UringBackend : public IOBackend
+{
+   private:
+      int ringFd;
+      void *sqRing,
+           *cqRing,
+           *sqes;
+      size_t sqRingSize,
+             cqRingSize,
+             sqesSize;
+      unsigned *sqHead,
+               *sqTail,
+               *sqMask,
+               *sqArray,
+               *cqHead,
+               *cqTail,
+               *cqMask;
+      void *cqes;
+      unsigned entries;
+      vector<IOTicket> inFlight;
+      mutex lock;
+      condition_variable room;
+      bool stopping;
+      thread completer;
+
+      void reap(void);
+      int push(IORequest *);
+      void complete(void);
+
+   public:
+      UringBackend(unsigned);
+      ~UringBackend();
+
+      bool isReady(void) const;
+      void submit(IOTicket);
+      void wait(IOTicket);
+      const char * name(void) const;
+};
+#endif
+
+/*=============================================================================
+Class:       IOEngine
+
+Description: Front end of the I/O layer. It picks a backend when constructed
+             and offers both single requests, which a batch caller can overlap,
+             and whole file helpers used by the database operations.
+
+DataFields:  backend:     the backend requests are given to
+             commitSync:  whether every commit is flushed to the device
+             scans:       sequential passes made by StreamReaders
+             scanBytes:   bytes they read
+             scanSeconds: time they took
+             lastBytes, lastSeconds, lastWaiting: bytes, time and time spent
+                          waiting on reads of the last pass
+             statsLock:   guards the pass metrics
+
+Functions:   IOEngine:    constructor; prefers io_uring and falls back to the
+                          thread pool
+             ~IOEngine:   destructor
+             read:        submit a read of a file region
+             write:       submit a write of a file region
+             wait:        block until a request has completed
+             readFile:    read a whole file
+             readPrefix:  read the first bytes of an open file
+             readRange:   read a range of an open file
+             appendFile:  append data to the end of a file
+             writeFile:   replace the contents of a file
+             syncFile:    flush a file or directory to the device
+             setCommitSync: choose whether every commit is flushed
+             getCommitSync: whether every commit is flushed
+             backendName: name of the backend in use
+             noteScan:    record a sequential pass
+             describeScans: throughput of sequential passes for the (s)Stats
+                          command
+=============================================================================*/
+class IOEngine
+{
+   private:
+      IOBackend *backend;
+      bool commitSync;
+      long scans;
+      long long scanBytes;
+      double scanSeconds;
+      long long lastBytes;
+      double lastSeconds,
+             lastWaiting;
+      mutable mutex statsLock;
+
+      /* Not copyable */
+      IOEngine(const IOEngine &);
+      IOEngine & operator=(const IOEngine &);
+
+   public:
+      IOEngine();
+      ~IOEngine();
+
+      IOTicket read(int, char *, size_t, off_t);
+      IOTicket write(int, const char *, size_t, off_t);
+      long wait(IOTicket);
+
+      string readFile(const string &);
+      string readPrefix(int, size_t);
+      string readRange(int, off_t, size_t);
+      bool appendFile(const string &, const string &);
+      bool writeFile(const string &, const string &);
+      bool syncFile(const string &);
+
+      void setCommitSync(bool);
+      bool getCommitSync(void) const;
+
+      const char * backendName(void) const;
+      void noteScan(long long, double, double);
+      string describeScans(void) const;
+};
+
+/*=============================================================================
+Class:       StreamWriter
+
+Description: Writes a new file sequentially in large blocks. Each full block is
+             submitted to the shared engine and the caller keeps filling the
+             next one while earlier blocks are still being written.
+
+DataFields:  fd:       file being written
+             offset:   file offset of the next block
+             buffer:   block being filled
+             inFlight: blocks submitted but not yet waited on
+             failed:   set once any write has failed
+
+Functions:   StreamWriter:  constructor
+             ~StreamWriter: destructor; closes a file left open
+             open:          create or truncate the file to write
+             openAppend:    open a file to write after its current end
+             write:         add bytes to the stream
+             close:         write what is buffered, wait for every block, sync
+                            and close the file
+             retire:        wait for the oldest block in flight
+             submitBuffer:  hand the current block to the engine
+=============================================================================*/
+class StreamWriter
+{
+   private:
+      int fd;
+      off_t offset;
+      string buffer;
+      deque<pair<IOTicket, shared_ptr<string> > > inFlight;
+      bool failed;
+
+      void retire(void);
+      void submitBuffer(void);
+
+      /* Not copyable */
+      StreamWriter(const StreamWriter &);
+      StreamWriter & operator=(const StreamWriter &);
+
+   public:
+      StreamWriter();
+      ~StreamWriter();
+
+      bool open(const string &);
+      bool openAppend(const string &);
+      void write(const char *, size_t);
+      void write(const string &);
+      bool close(void);
+};
+
+/*=============================================================================
+Class:       StreamReader
+
+Description: Reads a file, or a range of one, sequentially in large aligned
+             blocks, the counterpart of StreamWriter. The kernel is told the
+             range will be read sequentially, and the read of the next block is
+             submitted to the shared engine before the caller is handed the
+             current one, so the engine fills one buffer while the caller parses
+             the other. Rows can be taken whole, with a row cut by a block
+             boundary put together in a small side buffer. Closing the reader
+             records the bytes read, the time taken and the time spent waiting
+             on reads with the engine.
+
+DataFields:  fd:          file being read
+             isOwned:     whether the reader opened fd and closes it
+             offset:      file offset of the next block to submit
+             end:         end of the range
+             blockBytes:  size of each block
+             capacity:    size the buffers were allocated with
+             buffers:     the aligned blocks
+             inFlight:    reads submitted, with the buffer each fills
+             current:     buffer handed to the caller; -1 for none
+             blockOffset: file offset of the block handed to the caller
+             rest:        rows of the current block not yet handed out
+             restOffset:  file offset of rest
+             carry:       start of a row cut by the end of a block
+             carryOffset: file offset of carry
+             joined:      a row put together from two blocks
+             bytes:       bytes read
+             waiting:     seconds spent waiting on reads
+             started:     when the range was opened
+             failed:      set once a read has failed
+
+Functions:   StreamReader:  constructor
+             ~StreamReader: destructor; closes a range left open
+             open:          start reading a file, or a range of an open file
+             next:          the next block
+             nextRows:      the next whole rows
+             close:         wait for reads in flight, record the pass and close
+                            an owned file
+             submit:        start reading the next block into a buffer
+=============================================================================*/
+class StreamReader
+{
+   private:
+      int fd;
+      bool isOwned;
+      off_t offset,
+            end;
+      size_t blockBytes,
+             capacity;
+      char *buffers[2];
+      deque<pair<IOTicket, int> > inFlight;
+      int current;
+      off_t blockOffset;
+      string_view rest;
+      off_t restOffset;
+      string carry;
+      off_t carryOffset;
+      string joined;
+      long long bytes;
+      double waiting;
+      chrono :: steady_clock :: time_point started;
+      bool failed;
+
+      void submit(int);
+
+      /* Not copyable */
+      StreamReader(const StreamReader &);
+      StreamReader & operator=(const StreamReader &);
+
+   public:
+      StreamReader();
+      ~StreamReader();
+
+      bool open(const string &);
+      bool open(int, off_t, off_t);
+      bool next(string_view &);
+      bool nextRows(string_view &, off_t &);
+      bool close(void);
+};
+
+/* Engine shared by the whole program */
+IOEngine & ioEngine(void);
+
+#endif
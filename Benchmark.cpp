@@ -0,0 +1,252 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Benchmark.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the class Benchmark, which
+             runs one workload against the flat file and LSM engines.
+#############################################################################*/
+#include<chrono>
+#include<cstdio>
+#include<stdint.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<sys/stat.h>
+#include "Benchmark.h"
+#include "Lsm.h"
+#include "LookupCache.h"
+#include "Version.h"
+
+/* Letters in a generated name; 26 to this power exceeds every index */
+static const int NAME_LETTERS = 7;
+
+/*-----------------------------------------------------------------------------
+Name:        secondsSince
+
+Description: Time elapsed since a point.
+
+Algorithm:   Subtracts the point from the steady clock.
+
+Parameters:  start: the point
+
+Output:      seconds: time elapsed
+
+Result:      Seconds are returned.
+------------------------------------------------------------------------------*/
+static double secondsSince(chrono :: steady_clock :: time_point start)
+{
+   /* Return value */
+   return chrono :: duration<double>(chrono :: steady_clock :: now() -
+                                     start).count();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        Benchmark
+
+Description: Constructor.
+
+Algorithm:   Records the amount of clients.
+
+Parameters:  count: amount of clients inserted into each engine
+
+Output:      none
+
+Result:      Benchmark object is allocated.
+------------------------------------------------------------------------------*/
+Benchmark :: Benchmark(long count) : clients(count)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~Benchmark
+
+Description: Destructor.
+
+Algorithm:   Nothing to release.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Benchmark object is deallocated.
+------------------------------------------------------------------------------*/
+Benchmark :: ~Benchmark()
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        run
+
+Description: Time every engine.
+
+Algorithm:   A scratch directory named after the process is made and entered,
+             so the database in the working directory is not touched, and the
+             lookup cache turned off. Each engine is measured and deleted,
+             which waits for its background work. Removals of replaced
+             datafiles are waited for too, since files are removed by name,
+             before the scratch directory is emptied and removed and the
+             cache capacity restored.
+
+Parameters:  results: timings of each engine, in the order run
+
+Output:      true when every engine ran the workload correctly
+
+Result:      results holds a row per engine.
+------------------------------------------------------------------------------*/
+bool Benchmark :: run(vector<BenchmarkResult> &results)
+{
+   const string SCRATCH = "Benchmark." + to_string(getpid());
+   size_t capacity = lookupCache().getCapacity(); /* capacity to restore */
+   StorageEngine *engine;                         /* engine being measured */
+   bool isCorrect = true;                         /* every engine succeeded */
+   DIR *directory;                                /* the scratch directory */
+   struct dirent *entry;                          /* file being removed */
+
+   if(clients <= 0 || mkdir(SCRATCH.c_str(), 0755) != 0 ||
+      chdir(SCRATCH.c_str()) != 0)
+   {
+      rmdir(SCRATCH.c_str());
+      return false;
+   }
+   lookupCache().setCapacity(0);
+
+   for(int kind = 0; kind < 2; kind++)
+   {
+      BenchmarkResult result; /* timings of the engine */
+
+      if(kind == 0)
+         engine = new FlatFileEngine();
+      else
+         engine = new LsmEngine();
+
+      isCorrect = measure(*engine, result) && isCorrect;
+      results.push_back(result);
+      delete engine;
+   }
+
+   /* Finish every removal before leaving the directory */
+   reclaimer().finish();
+   lookupCache().clear();
+   lookupCache().setCapacity(capacity);
+
+   if((directory = opendir(".")) != NULL)
+   {
+      while((entry = readdir(directory)) != NULL)
+         if(entry->d_name[0] != '.')
+            unlink(entry->d_name);
+      closedir(directory);
+   }
+
+   if(chdir("..") != 0)
+      return false;
+   rmdir(SCRATCH.c_str());
+
+   /* Return value */
+   return isCorrect;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        measure
+
+Description: Time one engine.
+
+Algorithm:   Opens the engine and times the inserts, a tenth as many lookups of
+             inserted names spread over all of them, as many lookups of names
+             never inserted, one write and one reset. Every lookup result and
+             the occupancy are checked along the way.
+
+Parameters:  engine: the engine
+             result: its timings
+
+Output:      true when the engine returned the expected results
+
+Result:      result holds the engine's timings.
+------------------------------------------------------------------------------*/
+bool Benchmark :: measure(StorageEngine &engine, BenchmarkResult &result)
+{
+   chrono :: steady_clock :: time_point start; /* start of a step */
+   long lookups = clients / 10 > 0 ? clients / 10 : 1; /* of each kind */
+   long found = 0;                              /* lookups answered yes */
+   ClientRecord record;                         /* client looked up */
+   char id[16];                                 /* I.D. of a client */
+   bool isCorrect;                              /* results as expected */
+
+   result.engine = engine.name();
+   result.inserts = result.hits = result.misses = 0;
+   result.write = result.reset = 0;
+   if(!engine.open())
+      return false;
+
+   start = chrono :: steady_clock :: now();
+   for(long client = 0; client < clients; client++)
+   {
+      snprintf(id, sizeof(id), "A%08ld", client % 100000000);
+      engine.insert(clientName(client), id,
+                    (client % 12 + 1) * 10000 + (client % 28 + 1) * 100 + 90);
+   }
+   result.inserts = secondsSince(start);
+   isCorrect = engine.occupancy() == clients;
+
+   start = chrono :: steady_clock :: now();
+   for(long lookup = 0; lookup < lookups; lookup++)
+   {
+      long client = lookup * clients / lookups;
+
+      if(engine.lookup(clientName(client), record) &&
+         record.occupant == client + 1)
+         found++;
+   }
+   result.hits = secondsSince(start);
+   isCorrect = isCorrect && found == lookups;
+
+   start = chrono :: steady_clock :: now();
+   for(long lookup = 0; lookup < lookups; lookup++)
+      if(engine.lookup(clientName(clients + lookup), record))
+         isCorrect = false;
+   result.misses = secondsSince(start);
+
+   start = chrono :: steady_clock :: now();
+   isCorrect = !engine.write().empty() && isCorrect;
+   result.write = secondsSince(start);
+
+   start = chrono :: steady_clock :: now();
+   engine.reset();
+   result.reset = secondsSince(start);
+
+   /* Return value */
+   return isCorrect && engine.occupancy() == 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        clientName
+
+Description: Name of the client with an index.
+
+Algorithm:   The index is scrambled by multiplying with an odd constant, which
+             gives every index below 2^32 a different value, and the value is
+             written in base 26 as NAME_LETTERS lowercase letters. Consecutive
+             clients so land far apart in name order.
+
+Parameters:  index: the index
+
+Output:      name: the client's name
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+string Benchmark :: clientName(long index)
+{
+   uint32_t value = static_cast<uint32_t>(index) * 2654435761u;
+   string name(NAME_LETTERS, 'a');                 /* the name */
+
+   for(int letter = NAME_LETTERS - 1; letter >= 0; letter--)
+   {
+      name[letter] = 'a' + value % 26;
+      value /= 26;
+   }
+
+   /* Return value */
+   return name;
+}
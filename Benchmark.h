@@ -0,0 +1,78 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Benchmark.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definition of the class
+             Benchmark, which times the same workload on every storage engine.
+#############################################################################*/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include<string>
+#include<vector>
+#include "StorageEngine.h"
+
+using namespace std;
+
+/*=============================================================================
+Struct:      BenchmarkResult
+
+Description: Timings of one engine.
+
+DataFields:  engine:  name of the engine
+             inserts: seconds taken by the inserts
+             hits:    seconds taken by lookups of inserted names
+             misses:  seconds taken by lookups of names never inserted
+             write:   seconds taken by one (w)Write of the database
+             reset:   seconds taken by one reset
+=============================================================================*/
+struct BenchmarkResult
+{
+   string engine;
+   double inserts,
+          hits,
+          misses,
+          write,
+          reset;
+};
+
+/*=============================================================================
+Class:       Benchmark
+
+Description: Inserts a number of clients into each engine, looks up a tenth of
+             them and as many names that are not there, writes the database
+             out once and resets it, timing each step. The names are spread
+             over the key space in no particular order. The engines run in a
+             scratch directory that is removed afterwards, with the lookup
+             cache turned off so every lookup reaches the engine. Both engines
+             follow the IOEngine's commit policy, so their inserts are flushed
+             to the device equally often.
+
+DataFields:  clients: amount of clients inserted into each engine
+
+Functions:   Benchmark:  constructor
+             ~Benchmark: destructor
+             run:        time every engine
+             measure:    time one engine
+             clientName: name of the client with an index
+=============================================================================*/
+class Benchmark
+{
+   private:
+      long clients;
+
+      bool measure(StorageEngine &, BenchmarkResult &);
+      static string clientName(long);
+
+   public:
+      Benchmark(long);
+      ~Benchmark();
+
+      bool run(vector<BenchmarkResult> &);
+};
+
+#endif
@@ -14,16 +14,52 @@ Description: This file contains all functions that will be used for this
              database file DataFile.txt.
 #############################################################################*/
 #include<iostream>
-#include<fstream>
-#include<iomanip>
+#include<sstream>
+#include<cstdlib>
+#include<cctype>
+#include<atomic>
+#include<string_view>
 #include "Client.h"
+#include "Schema.h"
+#include "AsyncIO.h"
+#include "LookupCache.h"
+#include "Version.h"
+#include "Scheduler.h"
+#include "NameIndex.h"
 
 /* Formats for each data field used to format the datafile */
 static const int OCCUPANCY_CHARACTERS = 8;
 static const int NAME_CHARACTERS = 15;
 static const int IDENTIFICATION_CHARACTERS = 9;
 static const int BIRTHDAY_CHARACTERS = 6;
-static const char SEPARATOR[] = "\t\t\t";
+static constexpr char SEPARATOR[] = "\t\t\t";
+
+/* Column titles of the datafile */
+static constexpr char OCCUPANCY_TITLE[] = "Occupant";
+static constexpr char NAME_TITLE[] = "Client Name";
+static constexpr char IDENTIFICATION_TITLE[] = "Client I.D.";
+static constexpr char BIRTHDAY_TITLE[] = "Birthday";
+
+/* Layout of a client in the datafile and in snapshots, over a record type
+   with the client's datafields; the formatters and parsers are generated
+   from it */
+template<typename Record>
+using ClientLayout =
+   Schema<SEPARATOR,
+          Field<&Record :: occupant, OCCUPANCY_CHARACTERS, OCCUPANCY_TITLE,
+                '0', true>,
+          Field<&Record :: name, NAME_CHARACTERS, NAME_TITLE>,
+          Field<&Record :: identification, IDENTIFICATION_CHARACTERS,
+                IDENTIFICATION_TITLE>,
+          Field<&Record :: birthday, BIRTHDAY_CHARACTERS, BIRTHDAY_TITLE> >;
+
+/* The layout over copied clients, and over views of the row for parsing
+   without copying; both come from the one list of fields above */
+typedef ClientLayout<ClientRecord> ClientSchema;
+typedef ClientLayout<ClientView> ClientViewSchema;
+
+/* Bytes of the datafile searched by each lookup task */
+static const size_t LOOKUP_CHUNK = 4 << 20;
 
 /* Debug messages */
 static const char CREATE_CLIENT[] = "[Client object has been created]\n";
@@ -31,6 +67,8 @@ static const char CREATE_FILE[] = "[File object has been created]\n";
 static const char DESTROY_CLIENT[] = "[Client object has been deallocated]\n";
 static const char DESTROY_FILE[] = "[File object has been deallocated]\n";
 static const char INSERT[] = "[Inserting... ";
+static const char APPEND_FAILED[] = "[The row could not be appended]\n";
+static const char LOCK_FAILED[] = "[The write lock could not be taken]\n";
 static const char UPDATE_OCCUPANCY_FALSE[] = "[Reviewing occupancy]\n";
 static const char UPDATE_OCCUPANCY_TRUE[] = "[Updating occupancy]\n";
 static const char RESET[] = "[Clearing the database]\n";
@@ -61,10 +99,427 @@ class FileManager
       ~FileManager();
 
       /* Various function */
-      void makeFile(ofstream &);
-      string outputFile(ifstream &);
+      void makeFile(void);
+      string outputFile(void);
 };
 
+/*-----------------------------------------------------------------------------
+Name:        fileHeader
+
+Description: The header written at the top of the datafile.
+
+Algorithm:   Formats the column titles with the same widths as the rows and
+             follows them with a line of 75 separating characters.
+
+Parameters:  none
+
+Output:      header: text of the header
+
+Result:      Header text is returned.
+------------------------------------------------------------------------------*/
+static string fileHeader(void)
+{
+   const char HEADER_CHAR = '-';       /* Character the separates the header */
+   const int AMOUNT_HEADER_CHARS = 75; /* Amount of times to print the header
+                                          separating character */
+   string header;                      /* text of the header */
+
+   /* Format the column titles */
+   ClientSchema :: appendHeader(header);
+
+   /* Print the header separator character 75 times and terminate with a new
+      line */
+   header.append(AMOUNT_HEADER_CHARS, HEADER_CHAR);
+   header += '\n';
+
+   /* Return value */
+   return header;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        emptyGeneration
+
+Description: Replace the datafile with one holding only the header.
+
+Algorithm:   The header is written to a new file which is installed as the next
+             generation of the datafile, so readers pinned to the old one are
+             not disturbed. Must be called with a WriteLock held. Every cached
+             lookup is stale afterwards.
+
+Parameters:  none
+
+Output:      true when the empty datafile is in place
+
+Result:      The database holds no clients.
+------------------------------------------------------------------------------*/
+static bool emptyGeneration(void)
+{
+   const string TEMPORARY = string(DATA_FILE) + ".new"; /* next generation */
+   bool isInstalled;                                  /* result */
+
+   isInstalled = ioEngine().writeFile(TEMPORARY, fileHeader()) &&
+                 installGeneration(TEMPORARY, 0);
+
+   /* Every cached lookup is stale */
+   lookupCache().clear();
+
+   /* Return value */
+   return isInstalled;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        copyClient
+
+Description: Copy a client out of the row it was read from.
+
+Algorithm:   Assigns every field of the view to the record.
+
+Parameters:  client: the client as a view of its row
+             record: the copy
+
+Output:      void
+
+Result:      record holds the client.
+------------------------------------------------------------------------------*/
+static void copyClient(const ClientView &client, ClientRecord &record)
+{
+   record.occupant = client.occupant;
+   record.name.assign(client.name.data(), client.name.size());
+   record.identification.assign(client.identification.data(),
+                                client.identification.size());
+   record.birthday = client.birthday;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ClientRowIterator
+
+Description: Constructor.
+
+Algorithm:   Moves to the first line at or after the position that holds a
+             client.
+
+Parameters:  begin: start of a line
+             end:   end of the rows
+
+Output:      none
+
+Result:      ClientRowIterator object is at the first client, or at end.
+------------------------------------------------------------------------------*/
+ClientRowIterator :: ClientRowIterator(const char *begin, const char *end) :
+                     at(begin), end(end)
+{
+   advance();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        advance
+
+Description: Move to the next line holding a client.
+
+Algorithm:   Finds the end of each line with memchr and parses the line in
+             place, skipping lines that do not parse. Past the last line, the
+             row is left empty at the end of the rows, the same place end()
+             points at.
+
+Parameters:  none
+
+Output:      void
+
+Result:      client and row are the next client, or the iterator is at end.
+------------------------------------------------------------------------------*/
+void ClientRowIterator :: advance(void)
+{
+   while(at < end)
+   {
+      const char *lineEnd = static_cast<const char *>(
+                               memchr(at, '\n', end - at));
+      const char *lineStart = at;  /* start of the line being parsed */
+
+      if(lineEnd == NULL)
+         lineEnd = end;
+      at = lineEnd < end ? lineEnd + 1 : end;
+
+      if(ClientViewSchema :: parseRow(lineStart, lineEnd, client))
+      {
+         row = string_view(lineStart, lineEnd - lineStart);
+         return;
+      }
+   }
+
+   row = string_view(end, 0);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        operator*
+
+Description: The current client.
+
+Algorithm:   Returns client.
+
+Parameters:  none
+
+Output:      client: the current client
+
+Result:      Client is returned.
+------------------------------------------------------------------------------*/
+const ClientView & ClientRowIterator :: operator*(void) const
+{
+   /* Return value */
+   return client;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        operator->
+
+Description: The current client.
+
+Algorithm:   Returns the address of client.
+
+Parameters:  none
+
+Output:      client: the current client
+
+Result:      Client is returned.
+------------------------------------------------------------------------------*/
+const ClientView * ClientRowIterator :: operator->(void) const
+{
+   /* Return value */
+   return &client;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        operator++
+
+Description: Move to the next client.
+
+Algorithm:   Calls advance.
+
+Parameters:  none
+
+Output:      iterator: this iterator
+
+Result:      The iterator is at the next client, or at end.
+------------------------------------------------------------------------------*/
+ClientRowIterator & ClientRowIterator :: operator++(void)
+{
+   advance();
+
+   /* Return value */
+   return *this;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        operator==
+
+Description: Whether two iterators are at the same row.
+
+Algorithm:   Compares where the current rows start.
+
+Parameters:  other: the other iterator
+
+Output:      isSame: whether both are at the same row
+
+Result:      Whether the iterators are equal is returned.
+------------------------------------------------------------------------------*/
+bool ClientRowIterator :: operator==(const ClientRowIterator &other) const
+{
+   /* Return value */
+   return row.data() == other.row.data();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        operator!=
+
+Description: Whether two iterators are at different rows.
+
+Algorithm:   Compares where the current rows start.
+
+Parameters:  other: the other iterator
+
+Output:      isDifferent: whether the rows differ
+
+Result:      Whether the iterators differ is returned.
+------------------------------------------------------------------------------*/
+bool ClientRowIterator :: operator!=(const ClientRowIterator &other) const
+{
+   /* Return value */
+   return row.data() != other.row.data();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getRow
+
+Description: The current row.
+
+Algorithm:   Returns row.
+
+Parameters:  none
+
+Output:      row: the current row without its new line
+
+Result:      Row is returned.
+------------------------------------------------------------------------------*/
+string_view ClientRowIterator :: getRow(void) const
+{
+   /* Return value */
+   return row;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ClientRows
+
+Description: Constructor.
+
+Algorithm:   Keeps a view of the rows.
+
+Parameters:  rows: the rows; they must outlive the object and its iterators
+
+Output:      none
+
+Result:      ClientRows object is allocated.
+------------------------------------------------------------------------------*/
+ClientRows :: ClientRows(string_view rows) : text(rows)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        begin
+
+Description: Iterator at the first client.
+
+Algorithm:   Starts an iterator at the start of the rows.
+
+Parameters:  none
+
+Output:      iterator: at the first client
+
+Result:      Iterator is returned.
+------------------------------------------------------------------------------*/
+ClientRows :: iterator ClientRows :: begin(void) const
+{
+   /* Return value */
+   return iterator(text.data(), text.data() + text.size());
+}
+
+/*-----------------------------------------------------------------------------
+Name:        end
+
+Description: Iterator past the last client.
+
+Algorithm:   Starts an iterator at the end of the rows.
+
+Parameters:  none
+
+Output:      iterator: past the last client
+
+Result:      Iterator is returned.
+------------------------------------------------------------------------------*/
+ClientRows :: iterator ClientRows :: end(void) const
+{
+   /* Return value */
+   return iterator(text.data() + text.size(), text.data() + text.size());
+}
+
+/*-----------------------------------------------------------------------------
+Name:        findRow
+
+Description: Search part of the datafile for a client by name.
+
+Algorithm:   Finds each place the name occurs and parses the row holding it
+             in place, until a row whose name field equals the name is found or
+             the end is reached; rows not holding the name are never parsed,
+             and only the row found is copied into the record.
+
+Parameters:  begin:  first byte to search; the start of a row
+             end:    end of the part to search; the end of a row
+             nm:     name of client to search
+             record: the first client with the name, when found
+
+Output:      isFound: whether a client with the name was found
+
+Result:      record holds the client found.
+------------------------------------------------------------------------------*/
+static bool findRow(const char *begin, const char *end, string_view nm,
+                    ClientRecord &record)
+{
+   string_view text(begin, end - begin); /* the part searched */
+   size_t at = 0;                        /* search position */
+   ClientView client;                    /* row holding the name */
+
+   while((at = text.find(nm, at)) != string_view :: npos)
+   {
+      size_t lineStart = text.rfind('\n', at);
+      size_t lineEnd = text.find('\n', at);
+
+      lineStart = lineStart == string_view :: npos ? 0 : lineStart + 1;
+      if(lineEnd == string_view :: npos)
+         lineEnd = text.size();
+
+      if(ClientViewSchema :: parseRow(begin + lineStart, begin + lineEnd,
+                                      client) && client.name == nm)
+      {
+         copyClient(client, record);
+         return true;
+      }
+
+      at = lineEnd + 1;
+   }
+
+   /* Return value */
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        lookupIndexed
+
+Description: Search for a client with the name index.
+
+Algorithm:   The index, brought up to the snapshot, tells whether the name is
+             present and which client has it first. A present client is read
+             as the single row its occupant number places it at, and the row is
+             checked to hold that client. When the rows are not all in place,
+             or the index cannot answer for the snapshot, the caller has to
+             search the datafile.
+
+Parameters:  view:    snapshot being searched
+             nm:      name of client to search
+             isFound: whether a client with the name exists
+             record:  the first client with the name, when found
+
+Output:      isAnswered: whether isFound and record hold the answer
+
+Result:      isFound and record are set when answered.
+------------------------------------------------------------------------------*/
+static bool lookupIndexed(const ReadView &view, const string &nm,
+                          bool &isFound, ClientRecord &record)
+{
+   int occupant;     /* first client with the name */
+   long long offset; /* where its row starts */
+   string row;       /* the row read */
+
+   if(!nameIndex().find(view, nm, isFound, occupant, offset))
+      return false;
+   if(!isFound)
+      return true;
+
+   if(offset >= 0)
+   {
+      row = view.read(offset, ClientSchema :: rowWidth + 1);
+      if(row.size() > ClientSchema :: rowWidth &&
+         ClientSchema :: parseRow(row.data(),
+                                  row.data() + ClientSchema :: rowWidth,
+                                  record) &&
+         record.name == nm && record.occupant == occupant)
+         return true;
+   }
+
+   /* The caller searches the datafile */
+   isFound = false;
+
+   /* Return value */
+   return false;
+}
+
 /*-----------------------------------------------------------------------------
 Name:        debugOn
 
@@ -128,12 +583,11 @@ Name:        Client
 
 Description: Copy constructor that sets the datafields of the client.
 
-Algorithm:   Input parameters are initialized to corresponding datafields. The
-             datafields are set using the setters, and initialized using the
-             getters. occ is set to occupancy which is set from the
-             updateOccupancy function. If this is the first client, the
-             occupancy would be 0 and this will equal the first. The next
-             pointer always originates to NULL.
+Algorithm:   The datafields are set using the setters, which copy the name and
+             I.D. from the views passed in once. occ is set to occupancy which
+             is set from the updateOccupancy function. If this is the first
+             client, the occupancy would be 0 and this will equal the first.
+             The next pointer always originates to NULL.
 
 Parameters:  occ:  occupancy
              nm:   name
@@ -144,20 +598,14 @@ Output:      none
 
 Result:      Datafields of Client are all set.
 ------------------------------------------------------------------------------*/
-Client :: Client(int occ, string nm, string id, int bday) :
-          occupancy(updateOccupancy(false)), name(nm),
-          identification(id), birthday(bday)
+Client :: Client(int occ, string_view nm, string_view id, int bday) :
+          occupancy(updateOccupancy(false))
 {
    /* Set all the datafields */
    setName(nm);
    setIdentification(id);
    setBirthday(bday);
 
-   /* Initialize all the datafields */
-   name = getName();
-   identification = getIdentification();
-   birthday = getBirthday();
-
    /* Set parameter to occupancy datafield */
    occ = occupancy;
 
@@ -202,10 +650,10 @@ Output:      void
 
 Result:      Name is set.
 ------------------------------------------------------------------------------*/
-void Client :: setName(string nm)
+void Client :: setName(string_view nm)
 {
    /* Assignment */
-   nm = name;
+   name.assign(nm.data(), nm.size());
 }
 
 /*-----------------------------------------------------------------------------
@@ -221,10 +669,10 @@ Output:      void
 
 Result:      Identification is set.
 ------------------------------------------------------------------------------*/
-void Client :: setIdentification(string id)
+void Client :: setIdentification(string_view id)
 {
    /* Assignment */
-   id = identification;
+   identification.assign(id.data(), id.size());
 }
 
 /*-----------------------------------------------------------------------------
@@ -243,7 +691,7 @@ Result:      Birthday is set.
 void Client :: setBirthday(int bday)
 {
    /* Assignment */
-   bday = birthday;
+   birthday = bday;
 }
 
 /*-----------------------------------------------------------------------------
@@ -259,7 +707,7 @@ Output:      name: name of client
 
 Result:      Name is returned.
 ------------------------------------------------------------------------------*/
-string Client :: getName(void)
+const string & Client :: getName(void) const
 {
    /* Return value */
    return name;
@@ -278,7 +726,7 @@ Output:      identification: I.D. of client
 
 Result:      identification is returned.
 ------------------------------------------------------------------------------*/
-string Client :: getIdentification(void)
+const string & Client :: getIdentification(void) const
 {
    /* Return value */
    return identification;
@@ -297,7 +745,7 @@ Output:      birthday: birthday of client
 
 Result:      Birthday is returned.
 ------------------------------------------------------------------------------*/
-int Client :: getBirthday(void)
+int Client :: getBirthday(void) const
 {
    /* Return value */
    return birthday;
@@ -309,19 +757,20 @@ Name:        updateOccupancy
 Description: This function will keep track of the occupancy in the database and
              update it when needed.
 
-Algorithm:   Occupancy is read from the Occupancy.txt file. If this is called
-             from insert, it will increment the occupancy and overwrite the file
-             with it. Lastly, it will read in the updated occupancy from the
-             file. If this is not called from insert, incrementing occupancy is
-             skipped thus, occupancy will remain the same at the end of this
-             function.
+Algorithm:   Occupancy is read from the commit record in the Occupancy.txt
+             file. If this is called from insert, it will increment the
+             occupancy and commit the row just appended along with it; insert
+             holds the write lock. Should the commit fail the occupancy stays
+             as it was. If this is not called from insert,
+             incrementing occupancy is skipped thus, occupancy will remain the
+             same at the end of this function.
 
 Parameters:  fromInsert: determines wheather this is called from insert;
                          defaults to false
 
 Output:      occupancy: amount of clients in the database
 
-Result:      Occupancy is updated and written to the Occupancy.txt file for
+Result:      Occupancy is updated and committed to the Occupancy.txt file for
              reading in the future.
 ------------------------------------------------------------------------------*/
 int Client :: updateOccupancy(bool fromInsert = false)
@@ -330,35 +779,22 @@ int Client :: updateOccupancy(bool fromInsert = false)
    if(debug)
       cerr << UPDATE_OCCUPANCY_FALSE;
 
-   ifstream readOccFile;  /* used for reading Occupancy.txt */
-   ofstream writeOccFile; /* used for writing Occupancy.txt */
-   int updatedOccupancy;  /* temporary variable to hold occupancy if updated and
-                             occupancy will be assigned to it */
+   Manifest manifest; /* the commit record */
 
    /* Read occupancy */
-   readOccFile.open("Occupancy.txt");
-   readOccFile >> occupancy;
-   readOccFile.close();
+   readManifest(manifest);
+   occupancy = manifest.occupancy;
 
-   /* Increment occupancy if called from insert */
+   /* Increment occupancy and commit if called from insert */
    if(fromInsert)
    {
       if(debug)
          cerr << UPDATE_OCCUPANCY_TRUE;
 
-      writeOccFile.open("Occupancy.txt");
-      occupancy++;
-      writeOccFile << occupancy;
-      writeOccFile.close();
+      if(commitAppend(occupancy + 1))
+         occupancy++;
    }
 
-   /* Read updated occupancy(no change if not called from insert) and assign it
-      to occupancy */
-   readOccFile.open("Occupancy.txt");
-   readOccFile >> updatedOccupancy;
-   readOccFile.close();
-   occupancy = updatedOccupancy;
-
    /* Return value */
    return occupancy;
 }
@@ -368,22 +804,28 @@ Name:        insert
 
 Description: Insert a client in the database.
 
-Algorithm:   next is assigned to a new Client object. Occupancy represented by
-             parameter occ will call updateOccupancy to increment the occupancy.
-             The database will be appended with all the corresponding datafields
-             for the client inputted by the user. next will be deallocated to
-             prevent memory leaks.
+Algorithm:   next is assigned to a new Client object. The write lock is taken so
+             no other writer can append at the same time. A row with all the
+             corresponding datafields for the client inputted by the user is
+             formatted and appended to the database through the I/O engine.
+             Occupancy represented by parameter occ will call updateOccupancy
+             to increment the occupancy, which commits the row; readers do not
+             see it before then. If the write lock cannot be taken nothing is
+             written. If the append fails or is cut short, such as on a full
+             disk, nothing is committed, and the bytes that were written are
+             dropped by the next writer to take the lock. next
+             will be deallocated to prevent memory leaks.
 
 Parameters:  occ:  occupant number based on occupancy
              nm:   name of client
              id:   I.D. of client
              bday: birthday of client
 
-Output:      void
+Output:      isInserted: whether the client was committed
 
 Result:      DataFile.txt is appeded with a new client.
 ------------------------------------------------------------------------------*/
-void Client :: insert(int occ, string nm, string id, int bday)
+bool Client :: insert(int occ, string_view nm, string_view id, int bday)
 {
    /* Debug message */
    if(debug)
@@ -391,29 +833,53 @@ void Client :: insert(int occ, string nm, string id, int bday)
            << ", Birthday: " << bday << ", at occupant number: "
            << (occupancy + 1) << "]" << endl;
 
-   const string FILE_NAME = "DataFile.txt"; /* literal name of the database
-                                               file */
-   /* Call to append to the database */
-   ofstream clientFile(FILE_NAME.c_str(), ios :: app);
+   ClientRecord record;     /* the client being inserted */
+   string clientRow;        /* formatted row for the client */
+   Manifest committed;      /* commit record after the insert */
+   bool isInserted = false; /* the row was appended and committed */
 
    /* Insertion begins by assigning next pointer to a new client */
    next = new Client(occ, nm, id, bday);
 
-   /* Update the occupancy */
-   occ = updateOccupancy(true);
+   {
+      WriteLock writer; /* excludes other writers until the row is committed */
+
+      if(!writer.isHeld())
+      {
+         if(debug)
+            cerr << LOCK_FAILED;
+         delete next;
+         return false;
+      }
 
-   /* Append to the database file the client being inserted */
-   clientFile << setw(OCCUPANCY_CHARACTERS) << setfill('0') << right << occ
-              << SEPARATOR << setw(NAME_CHARACTERS) << setfill (' ') << left
-              << nm << SEPARATOR << setw(IDENTIFICATION_CHARACTERS) << left
-              << id << SEPARATOR << setw(BIRTHDAY_CHARACTERS) << left << bday
-              << SEPARATOR << endl;
+      /* Fill in the client being inserted */
+      record.occupant = writer.getManifest().occupancy + 1;
+      record.name.assign(nm.data(), nm.size());
+      record.identification.assign(id.data(), id.size());
+      record.birthday = bday;
+
+      /* Append the row to the database file */
+      ClientSchema :: appendRow(clientRow, record);
+      if(ioEngine().appendFile(writer.getManifest().file, clientRow))
+      {
+         /* Update the occupancy, committing the row */
+         occ = updateOccupancy(true);
+         isInserted = occ == record.occupant;
+         readManifest(committed);
+      }
+      else if(debug)
+         cerr << APPEND_FAILED;
+   }
+
+   /* Only a cached lookup of this name can change */
+   if(isInserted)
+      lookupCache().noteInsert(record, committed);
 
    /* Deallocation */
    delete next;
 
-   /* Close the file */
-   clientFile.close();
+   /* Return value */
+   return isInserted;
 }
 
 /*-----------------------------------------------------------------------------
@@ -421,14 +887,19 @@ Name:        reset
 
 Description: Clear the datafile.
 
-Algorithm:   Overwrite the occupancy file with 0 to empty the database. When
-             occupancy is read as 0, the driver will clear the datafile.
+Algorithm:   Under the write lock, a datafile holding only the header is
+             installed as a new generation with occupancy 0 and the lookup
+             cache is cleared. The old datafile is neither truncated nor
+             rewritten; it is removed in the background, so a reset takes the
+             same time however many clients there were. Lookups and writes
+             already reading the old generation finish against it undisturbed.
+             Nothing is changed if the write lock cannot be taken.
 
 Parameters:  none
 
 Output:      none
 
-Result:      Occupancy is reset to 0.
+Result:      Occupancy is reset to 0 and the datafile is empty.
 ------------------------------------------------------------------------------*/
 void Client :: reset(void)
 {
@@ -436,12 +907,13 @@ void Client :: reset(void)
    if(debug)
       cerr << RESET;
 
-   ofstream occFile; /* write the occupancy file */
+   WriteLock writer; /* excludes other writers */
 
-   /* Overwrite the occupancy file with 0 */
-   occFile.open("Occupancy.txt");
-   occFile << 0;
-   occFile.close();
+   /* Swap in an empty generation */
+   if(writer.isHeld())
+      emptyGeneration();
+   else if(debug)
+      cerr << LOCK_FAILED;
 }
 
 /*-----------------------------------------------------------------------------
@@ -449,21 +921,29 @@ Name:        lookup
 
 Description: Search for a client based on name entry.
 
-Algorithm:   Open the datafile. Search the file for the name to search while the
-             search has not reached EOF. Once the name is found in the file, the
-             flag isFound to determine wheather client exists, will be set to
-             true and break from the search loop. Once EOF is reached and name
-             has not been found, the isFound flag will remain false.
-
-Parameters:  clientFile: the file that holds the clients to be looked for
-             nm:         name of client to search
+Algorithm:   A snapshot of the database is pinned without taking any lock. The
+             lookup cache is checked first, after it is cleared if the
+             snapshot's commit record shows the database was changed by another
+             process. On a miss, the name index is asked next. Only when it
+             cannot answer, map the committed part of the snapshot's
+             datafile and cut it on row boundaries into chunks of about
+             LOOKUP_CHUNK bytes, which are searched as foreground tasks of the
+             scheduler. Chunks after the earliest one with a match stop early,
+             and the match of the earliest chunk is the first client with the
+             name. Once the name is found, the flag isFound to determine
+             wheather client exists, will be set to true. Once the end is
+             reached and name has not been found, the isFound flag will remain
+             false. Either result is stored in the cache.
+
+Parameters:  nm:     name of client to search
+             record: the first client with the name, when found
 
 Output:      isFound: status of wheather the desired client has been found
 
 Result:      Returns either true or false depending on wheather the client has
              been found in the database.
 ------------------------------------------------------------------------------*/
-bool Client :: lookup(ifstream &clientFile, string nm)
+bool Client :: lookup(string_view nm, ClientRecord &record)
 {
    /* Debug message */
    if(debug)
@@ -471,31 +951,99 @@ bool Client :: lookup(ifstream &clientFile, string nm)
 
    bool isFound = false; /* flag determining if client is found defaults to
                             false */
-   string line;          /* string representing the items searched in the
-                            file */
-   int offset;           /* represent the area of the file searched */
+   ReadView view; /* snapshot being searched */
+   const string key(nm); /* name as the cache and index key it; names fit
+                            the string's own buffer */
+
+   /* Answer from the cache when possible */
+   lookupCache().validate(view.getManifest());
+   if(lookupCache().find(key, isFound, record))
+      return isFound;
+
+   /* Answer from the name index when possible */
+   if(lookupIndexed(view, key, isFound, record))
+   {
+      lookupCache().store(key, isFound, record, view.getManifest());
+      return isFound;
+   }
+
+   string_view content = view.map(); /* committed part of the datafile */
+   size_t chunks = content.size() / LOOKUP_CHUNK + 1; /* parts searched */
+   vector<size_t> bounds(chunks + 1);      /* where each part starts */
+   vector<ClientRecord> found(chunks);     /* match of each part */
+   atomic<size_t> earliest(chunks);        /* first part with a match */
 
-   /* Perform linear search on the file for the client until EOF is reached */
-   clientFile.open("DataFile.txt");
-   while(!clientFile.eof())
+   /* Cut the datafile on row boundaries */
+   bounds[0] = 0;
+   bounds[chunks] = content.size();
+   for(size_t chunk = 1; chunk < chunks; chunk++)
    {
-      getline(clientFile, line);
+      size_t lineEnd = content.find('\n', chunk * LOOKUP_CHUNK);
+
+      bounds[chunk] = lineEnd == string_view :: npos ? content.size() :
+                                                       lineEnd + 1;
+      if(bounds[chunk] < bounds[chunk - 1])
+         bounds[chunk] = bounds[chunk - 1];
+   }
 
-      /* Flag becomes true if found and search stops */
-      if((offset = line.find(nm, 0)) != string :: npos)
+   /* Perform linear search on every part for the client; a part after the
+      earliest match found so far is skipped */
+   scheduler().parallelFor(FOREGROUND, 0, chunks, 1,
+      [&](size_t first, size_t last)
       {
-         isFound = true;
-         break;
-      }
+         for(size_t chunk = first; chunk < last; chunk++)
+         {
+            if(chunk > earliest)
+               return;
+
+            if(findRow(content.data() + bounds[chunk],
+                       content.data() + bounds[chunk + 1], nm, found[chunk]))
+            {
+               size_t seen = earliest;
+               while(chunk < seen &&
+                     !earliest.compare_exchange_weak(seen, chunk))
+                  ;
+               return;
+            }
+         }
+      });
+
+   /* Flag becomes true if found */
+   if(earliest < chunks)
+   {
+      isFound = true;
+      record = found[earliest];
    }
 
-   /* Close the file */
-   clientFile.close();
+   /* Remember the result */
+   lookupCache().store(key, isFound, record, view.getManifest());
 
    /* Return value */
    return isFound;
 }
 
+/*-----------------------------------------------------------------------------
+Name:        lookup
+
+Description: Search for a client based on name entry.
+
+Algorithm:   Calls lookup and discards the client found.
+
+Parameters:  nm: name of client to search
+
+Output:      isFound: status of wheather the desired client has been found
+
+Result:      Returns either true or false depending on wheather the client has
+             been found in the database.
+------------------------------------------------------------------------------*/
+bool Client :: lookup(string_view nm)
+{
+   ClientRecord record; /* the client found; unused */
+
+   /* Return value */
+   return lookup(nm, record);
+}
+
 /*-----------------------------------------------------------------------------
 Name:        FileManager
 
@@ -541,44 +1089,34 @@ Name:        makeFile
 
 Description: Create a new database file.
 
-Algorithm:   Open the datafile and overwrite it with the file header. File will
-             be void of clients.
+Algorithm:   Under the write lock, install a datafile holding only the file
+             header as a new generation. File will be void of clients. If
+             another process committed a client since occupancy was read, its
+             database is kept instead, as it is when the write lock cannot be
+             taken.
 
-Parameters:  clientFile: the new datafile to write
+Parameters:  none
 
 Output:      none
 
 Result:      A new datafile now exists.
 ------------------------------------------------------------------------------*/
-void FileManager :: makeFile(ofstream &clientFile)
+void FileManager :: makeFile(void)
 {
    /* Debug message */
    if(debug)
       cerr << MAKE_FILE;
 
-   const char HEADER_CHAR = '-';       /* Character the separates the header */
-   const int AMOUNT_HEADER_CHARS = 75; /* Amount of times to print the header
-                                          separating character */
-
-   /* Open the datafile */
-   clientFile.open("DataFile.txt");
+   WriteLock writer; /* excludes other writers */
 
-   /* Overwrite the datafile with the header */
-   clientFile << setw(OCCUPANCY_CHARACTERS) << setfill('0') << left
-              << "Occupant" << SEPARATOR << setw(NAME_CHARACTERS)
-              << setfill (' ') << left << "Client Name" << SEPARATOR
-              << setw(IDENTIFICATION_CHARACTERS) << left << "Client I.D."
-              << SEPARATOR << setw(BIRTHDAY_CHARACTERS) << left << "Birthday"
-              << SEPARATOR << endl;
-
-   /* Print the header separator character 75 times and terminate with a new
-      line */
-   for(int amount = 1; amount <= AMOUNT_HEADER_CHARS; amount++)
-      clientFile << HEADER_CHAR;
-   clientFile << '\n';
-
-   /* Close the file */
-   clientFile.close();
+   /* Replace the datafile unless it gained clients meanwhile */
+   if(!writer.isHeld())
+   {
+      if(debug)
+         cerr << LOCK_FAILED;
+   }
+   else if(writer.getManifest().occupancy == 0)
+      emptyGeneration();
 }
 
 /*-----------------------------------------------------------------------------
@@ -586,37 +1124,52 @@ Name:        outputFile
 
 Description: Write out the file to stdout.
 
-Algorithm:   File will be read up to the end. The string fileContent will
-             constantly be appended with the file contents of DataFile.txt.
+Algorithm:   A snapshot is pinned and its committed part streamed through a
+             StreamReader, so inserts made meanwhile neither wait nor appear and
+             the next block is read while the current one is copied. The
+             string fileContent will constantly be appended with the file
+             contents of DataFile.txt, every run of characters between
+             whitespace in turn, which is what reading it word by word gives.
 
-Parameters:  clientFile: the file to write to stdout
+Parameters:  none
 
 Output:      fileContent: the contents of the datafile
 
 Result:      The datafile is printed to stdout.
 -----------------------------------------------------------------------------*/
-string FileManager :: outputFile(ifstream &clientFile)
+string FileManager :: outputFile(void)
 {
    /* Debug message */
    if(debug)
       cerr << WRITE;
 
    string fileContent;  /* contents of the datafile */
-   string clipFromFile; /* contents read from file to append to the file
-                           contents */
+   ReadView view;       /* snapshot being written out */
+   StreamReader reader; /* reads the datafile ahead */
+   string_view block;   /* block of the datafile read */
 
    /* Read the whole file and constantly append to the string holding its
       contents */
-   clientFile.open("DataFile.txt");
-   while(!clientFile.eof())
+   fileContent.reserve(view.getManifest().bytes);
+   if(view.stream(reader, 0))
    {
-      clientFile >> clipFromFile;
-      fileContent += clipFromFile;
+      while(reader.next(block))
+         for(size_t at = 0; at < block.size(); )
+         {
+            size_t word = at; /* start of a run of characters */
+
+            while(at < block.size() && !isspace(
+                     static_cast<unsigned char>(block[at])))
+               at++;
+            fileContent.append(block.data() + word, at - word);
+
+            while(at < block.size() &&
+                  isspace(static_cast<unsigned char>(block[at])))
+               at++;
+         }
+      reader.close();
    }
 
-   /* Close the file */
-   clientFile.close();
-
    /* Return value */
    return fileContent;
-}
+}
\ No newline at end of file
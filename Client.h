@@ -13,9 +13,120 @@ Description: This is a header file containing the function definitions and
 #define CLIENT_H
 
 #include<string>
+#include<string_view>
 
 using namespace std;
 
+/*=============================================================================
+Struct:      ClientRecord
+
+Description: One client as it is stored in a row of the datafile.
+
+DataFields:  occupant:       occupant number of the client
+             name:           name of client
+             identification: client I.D. in form Axxxxxxxx
+             birthday:       birthday of client as xxxxxx
+=============================================================================*/
+struct ClientRecord
+{
+   int occupant;
+   string name;
+   string identification;
+   int birthday;
+};
+
+/*=============================================================================
+Struct:      ClientView
+
+Description: One client as it is read from a row, with the text fields pointing
+             into the row instead of copied out of it. A view is only valid
+             while the data it was read from is.
+
+DataFields:  occupant:       occupant number of the client
+             name:           name of client
+             identification: client I.D. in form Axxxxxxxx
+             birthday:       birthday of client as xxxxxx
+=============================================================================*/
+struct ClientView
+{
+   int occupant;
+   string_view name;
+   string_view identification;
+   int birthday;
+};
+
+/*=============================================================================
+Class:       ClientRowIterator
+
+Description: Position of a client among datafile rows. Each step finds the
+             next line and parses it in place into a ClientView; lines that are
+             not client rows, such as the header, are skipped. Nothing is
+             copied and nothing allocated.
+
+DataFields:  at:     start of the line after the current row
+             end:    end of the rows
+             row:    the current row, without its new line
+             client: the current client
+
+Functions:   ClientRowIterator: constructor; moves to the first client at or
+                                after a position
+             operator*:         the current client
+             operator->:        the current client
+             operator++:        move to the next client
+             operator==:        whether two iterators are at the same row
+             operator!=:        whether two iterators are at different rows
+             getRow:            the current row
+             advance:           move to the next line holding a client
+=============================================================================*/
+class ClientRowIterator
+{
+   private:
+      const char *at,
+                 *end;
+      string_view row;
+      ClientView client;
+
+      void advance(void);
+
+   public:
+      ClientRowIterator(const char *, const char *);
+
+      const ClientView & operator*(void) const;
+      const ClientView * operator->(void) const;
+      ClientRowIterator & operator++(void);
+      bool operator==(const ClientRowIterator &) const;
+      bool operator!=(const ClientRowIterator &) const;
+
+      string_view getRow(void) const;
+};
+
+/*=============================================================================
+Class:       ClientRows
+
+Description: The clients of a run of datafile rows, for iterating over with a
+             range for loop without copying a row or allocating memory. The
+             clients are views into the rows, valid while the rows are.
+
+DataFields:  text: the rows
+
+Functions:   ClientRows: constructor
+             begin:      iterator at the first client
+             end:        iterator past the last client
+=============================================================================*/
+class ClientRows
+{
+   private:
+      string_view text;
+
+   public:
+      typedef ClientRowIterator iterator;
+
+      ClientRows(string_view);
+
+      iterator begin(void) const;
+      iterator end(void) const;
+};
+
 /*=============================================================================
 Class:       Client
 
@@ -68,24 +179,25 @@ class Client
 
       /* Constructors and destructor */
       Client();
-      Client(int, string, string, int);
+      Client(int, string_view, string_view, int);
       ~Client();
 
       /* Setters */
-      void setName(string);
-      void setIdentification(string);
+      void setName(string_view);
+      void setIdentification(string_view);
       void setBirthday(int);
 
       /* Getters */
-      string getName(void);
-      string getIdentification(void);
-      int getBirthday(void);
+      const string & getName(void) const;
+      const string & getIdentification(void) const;
+      int getBirthday(void) const;
 
       /* Various functions for a database */
       int updateOccupancy(bool);
-      void insert(int, string, string, int);
+      bool insert(int, string_view, string_view, int);
       void reset(void);
-      bool lookup(ifstream &, string);
+      bool lookup(string_view, ClientRecord &);
+      bool lookup(string_view);
 };
 
 #endif
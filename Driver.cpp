@@ -9,13 +9,32 @@ Description: The driver file calls client functions that modify the database.
              Functions are called based on user input of chars that are defined
              in this file.
 #############################################################################*/
+#include "AsyncIO.cpp"
+#include "Scheduler.cpp"
+#include "Version.cpp"
+#include "LookupCache.cpp"
 #include "Client.cpp"
+#include "Snapshot.cpp"
+#include "Ingest.cpp"
+#include "NameIndex.cpp"
+#include "StorageEngine.cpp"
+#include "Lsm.cpp"
+#include "Benchmark.cpp"
 #include<getopt.h>
 #include<cstdlib>
 #include<cstdio>
+#include<iomanip>
 
-/* Prototype function for a separate debug mode setter to be called in main */
-void debugSetter(int, char * const *);
+/* Prototype function for a separate setter of the debug mode, cache
+   capacity, storage engine, commit policy and benchmark to be called in
+   main */
+void optionSetter(int, char * const *, string &, long &);
+
+/* Prototype function printing the timings of a benchmark */
+void printBenchmark(const vector<BenchmarkResult> &);
+
+/* Prototype function printing the clients found by a name query */
+void printMatches(const vector<NameEntry> &);
 
 /*-----------------------------------------------------------------------------
 Name:        main
@@ -32,8 +51,8 @@ Algorithm:   A while loop is implemented as long as cin is true. Based on input
              ensure that 2 lines are written in every instance the loop starts
              again.
 
-Parameters:  arg1: default argument 1 used to set debug mode
-             arg2: default argument 2 used to set debug mode
+Parameters:  arg1: default argument 1 used to set debug mode and options
+             arg2: default argument 2 used to set debug mode and options
 
 Output:      Default return 0.
 
@@ -41,38 +60,78 @@ Result:      Main function actually runs the program to modify the database.
 -----------------------------------------------------------------------------*/
 int main(int arg1, char * const * arg2)
 {
-   int occ,                   /* input occupancy */
-       bday;                  /* input birthday */
+   int bday;                  /* input birthday */
 
    string nm,                 /* input name */
-          id;                 /* input identification */
+          id,                 /* input identification */
+          last;               /* input last name of a range */
 
    char command;              /* command to call a corresponding function from
                                  Client.cpp */
 
-   ofstream outClientFile;    /* file output object */
-   ifstream inClientFile;     /* file input object */
-   
-   Client client;             /* Client object to call Client functions */
-   FileManager fileManager;   /* FileManager object to call FileManager
-                                 functions */
+   StorageEngine *engine;     /* engine storing the clients */
+   Snapshot snapshot;         /* Snapshot object to dump and load the
+                                 database */
+   Ingestor ingestor;         /* Ingestor object to bulk load CSV and TSV
+                                 files */
+   IngestReport report;       /* outcome of a bulk load */
+   string path;               /* input snapshot or CSV file */
+   long total;                /* clients dumped or loaded */
+   string engineOption;       /* storage engine chosen with -e */
+   long benchmarkClients = 0; /* clients per engine for -b; 0 for none */
+   ClientRecord record;       /* client found by a lookup; unused */
+   vector<NameEntry> matches; /* clients found by a name query */
+
+   /* Call this function to set up the debug mode, cache capacity, engine and
+      benchmark based on the command line arguments specified by arg1 and
+      arg2 */
+   optionSetter(arg1, arg2, engineOption, benchmarkClients);
+
+   /* Run the benchmark instead of the database, in a directory of its own */
+   if(benchmarkClients > 0)
+   {
+      Benchmark benchmark(benchmarkClients); /* times every engine */
+      vector<BenchmarkResult> results;       /* timings of each engine */
+      bool isCorrect = benchmark.run(results);
+
+      printBenchmark(results);
+      if(!isCorrect)
+         cout << "The benchmark did not complete correctly!" << endl;
 
-   /* Call this function to set up the debug mode based on the command line
-      arguments specified by arg1 and arg2 */
-   debugSetter(arg1, arg2);
+      return isCorrect ? 0 : 1;
+   }
 
-   /* Automatically reset the file if there are no clients; occupancy of 0 */
-   if(client.updateOccupancy(false) == 0)
-      fileManager.makeFile(outClientFile);
+   /* Choose the storage engine; the flat file engine by default */
+   if(engineOption == "lsm")
+      engine = new LsmEngine();
+   else if(engineOption.empty() || engineOption == "flat")
+      engine = new FlatFileEngine();
+   else
+   {
+      cout << engineOption << " is not a storage engine! Use flat or lsm."
+           << endl;
+      return 1;
+   }
+
+   /* Open the database; the flat file engine makes a fresh datafile when
+      there are no clients */
+   if(!engine->open())
+   {
+      cout << "Could not open the " << engine->name() << " engine! Is another"
+              " process using it?" << endl;
+      delete engine;
+      return 1;
+   }
 
    /* This loop runs the program by constantly calling functions specified by
       user input of commands chars */
    while(cin)
    {
       /* Prompting message */
-      cout << "\nDatabase contains " << client.updateOccupancy()
+      cout << "\nDatabase contains " << engine->occupancy()
            << " client(s).\n"
-           << "Select a command... (i)Insert (l)Lookup (r)Reset (w)Write: ";
+           << "Select a command... (i)Insert (l)Lookup (p)Prefix R(a)nge "
+              "(r)Reset (w)Write (d)Dump L(o)ad (c)CSV (s)Stats: ";
 
       /* Reset command to null */
       command = 0;
@@ -98,7 +157,8 @@ int main(int arg1, char * const * arg2)
             cin >> bday;
 
             /* Insert input into the database */
-            client.insert(occ, nm, id, bday);
+            if(!engine->insert(nm, id, bday))
+               cout << "Could not insert " << nm << "!" << endl;
 
             /* Keep stdout consistent */
             cout << endl;
@@ -107,7 +167,7 @@ int main(int arg1, char * const * arg2)
          case 'l': /* Searching for a client */
 
             /* Don't do anything if database is empty and exit this case */
-            if(client.updateOccupancy(false) == 0)
+            if(engine->occupancy() == 0)
             {
                /* Prompt issue */
                cout << "The database is empty!" << endl;
@@ -122,7 +182,7 @@ int main(int arg1, char * const * arg2)
             cin >> nm;
 
             /* Found or not */
-            if(client.lookup(inClientFile, nm + ' '))
+            if(engine->lookup(nm, record))
                cout << "Client " << nm << " found!" << endl;
             else
                cout << "Client " << nm << " not found!" << endl;
@@ -131,11 +191,41 @@ int main(int arg1, char * const * arg2)
             cout << endl;
          break;
 
+         case 'p': /* Clients whose names start with a text */
+
+            /* Prompt and input for the start of the names */
+            cout << "Enter the start of the names to list: ";
+            cin >> nm;
+
+            /* List the clients found */
+            engine->prefix(nm, matches);
+            printMatches(matches);
+
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
+         case 'a': /* Clients whose names lie between two names */
+
+            /* Prompt and input for the first and last names */
+            cout << "Enter the first name of the range: ";
+            cin >> nm;
+            cout << "Enter the last name of the range: ";
+            cin >> last;
+
+            /* List the clients found */
+            engine->range(nm, last, matches);
+            printMatches(matches);
+
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
          case 'r': /* Clear the database */
 
             /* Don't do anything if database is already empty and exit this
                case */
-            if(client.updateOccupancy() == 0)
+            if(engine->occupancy() == 0)
             {
                /* Prompt issue */
                cout << "The database is empty!" << endl;
@@ -166,25 +256,138 @@ int main(int arg1, char * const * arg2)
 
             /* Reset the occupancy and clear the database for command 'y' */
             if(command == 'y')
+               engine->reset();
+
+            /* Exit this case for command 'n' */
+            else
             {
-               client.reset();
-               fileManager.makeFile(outClientFile);
+               /* Keep stdout consistent */
+               cout << endl;
+               break;
             }
 
-            /* Exit this case for command 'n' */
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
+         case 'd': /* Dump the database to a snapshot file */
+
+            /* Snapshots and bulk loads work on the datafile */
+            if(!engine->hasDataFile())
+            {
+               /* Prompt issue */
+               cout << "The " << engine->name() << " engine does not keep a "
+                       "datafile!" << endl;
+
+               /* Keep stdout consistent */
+               cout << endl;
+               break;
+            }
+
+            /* Prompt and input for the snapshot file */
+            cout << "Enter the snapshot file to write: ";
+            cin >> path;
+
+            /* Written or not */
+            if((total = snapshot.dump(path)) >= 0)
+               cout << "Dumped " << total << " client(s) to " << path << "!"
+                    << endl;
+            else
+               cout << "Could not dump to " << path << "!" << endl;
+
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
+         case 'o': /* Replace the database with a snapshot file */
+
+            /* Snapshots and bulk loads work on the datafile */
+            if(!engine->hasDataFile())
+            {
+               /* Prompt issue */
+               cout << "The " << engine->name() << " engine does not keep a "
+                       "datafile!" << endl;
+
+               /* Keep stdout consistent */
+               cout << endl;
+               break;
+            }
+
+            /* Prompt and input for the snapshot file */
+            cout << "Enter the snapshot file to load: ";
+            cin >> path;
+
+            /* Loaded or not; the database is untouched when not */
+            if((total = snapshot.load(path)) >= 0)
+               cout << "Loaded " << total << " client(s) from " << path << "!"
+                    << endl;
             else
+               cout << path << " is not a valid snapshot!" << endl;
+
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
+         case 'c': /* Bulk load a CSV or TSV file */
+
+            /* Snapshots and bulk loads work on the datafile */
+            if(!engine->hasDataFile())
             {
+               /* Prompt issue */
+               cout << "The " << engine->name() << " engine does not keep a "
+                       "datafile!" << endl;
+
                /* Keep stdout consistent */
                cout << endl;
                break;
             }
 
+            /* Prompt and input for the file */
+            cout << "Enter the CSV or TSV file to ingest: ";
+            cin >> path;
+
+            /* Ingested or not */
+            if(ingestor.ingest(path, report))
+            {
+               cout << "Ingested " << report.accepted << " client(s) in "
+                    << report.seconds << " second(s)";
+               if(report.seconds > 0)
+                  cout << " (" << static_cast<long>(report.accepted /
+                                                    report.seconds)
+                       << " clients/s, " << report.bytes / 1048576.0 /
+                                            report.seconds << " MB/s)";
+               cout << "." << endl;
+
+               if(report.rejected > 0)
+                  cout << report.rejected << " row(s) rejected, see "
+                       << report.rejects << endl;
+            }
+            else
+               cout << "Could not ingest " << path << "!" << endl;
+
+            /* Keep stdout consistent */
+            cout << endl;
+         break;
+
+         case 's': /* Show the cache, scheduler, scan and engine metrics */
+            cout << "Lookup cache: " << lookupCache().getHits() << " hit(s), "
+                 << lookupCache().getMisses() << " miss(es), "
+                 << lookupCache().hitRatio() * 100 << "% hit ratio, "
+                 << lookupCache().getInvalidations() << " invalidation(s), "
+                 << lookupCache().getSize() << " of "
+                 << lookupCache().getCapacity() << " entries used." << endl;
+            cout << "Scheduler: " << scheduler().getWorkers() << " worker(s), "
+                 << scheduler().getExecuted() << " task(s) run, "
+                 << scheduler().getSteals() << " stolen." << endl;
+            cout << ioEngine().describeScans() << endl;
+            cout << engine->describe() << endl;
+
             /* Keep stdout consistent */
             cout << endl;
          break;
 
          case 'w': /* Write out the datafile to stdout */
-            cout << fileManager.outputFile(inClientFile) << endl;
+            cout << engine->write() << endl;
 
          /* Invalid command or exit program */
          default:
@@ -193,42 +396,136 @@ int main(int arg1, char * const * arg2)
       }
    }
 
+   /* Deallocation; waits for the engine's background work */
+   delete engine;
+
    /* Default return for main */
    return 0;
 }
 
 /*-----------------------------------------------------------------------------
-Name:        debugSetter
+Name:        optionSetter
 
-Description: Set the debug mode to on or off based on command line argument.
+Description: Set the debug mode to on or off, the lookup cache capacity, the
+             storage engine, the commit policy and the benchmark based on
+             command line arguments.
 
 Algorithm:   Set debug off by default and use a while loop to determine if
              commands line argument exists to turn it on. Otherwise, it is
-             automatically off.
+             automatically off. An argument -c followed by a number sets the
+             most lookups kept in the cache; 0 turns the cache off. An argument
+             -e followed by flat or lsm chooses the storage engine, -s flushes
+             every commit to the device instead of only on generation swaps
+             and at exit, and -b followed by a number runs the benchmark with
+             that many clients.
+
+Parameters:  arg1:             default argument 1 from main
 
-Parameters:  arg1: default argument 1 from main
+             arg2:             default argument 2 from main
 
-             arg2: default argument 2 from main
+             engineOption:     the storage engine named by -e
+
+             benchmarkClients: the number following -b
 
 Output:      void
 
-Result:      Debug is either enabled or disabled during execution.
+Result:      Debug is either enabled or disabled during execution, the cache
+             capacity and commit policy are set and the engine and benchmark
+             are chosen.
 -----------------------------------------------------------------------------*/
-void debugSetter(int arg1, char * const * arg2)
+void optionSetter(int arg1, char * const * arg2, string &engineOption,
+                  long &benchmarkClients)
 {
-   char option; /* determines debug mode */
+   int option; /* determines debug mode, cache capacity, engine, commit
+                  policy and benchmark */
 
    /* Set if off by default */
    debugOff();
 
-   /* Loop executes when argument is present and will turn on debug mode */
-   while((option = getopt(arg1, arg2, "x")) != EOF)
+   /* Loop executes when argument is present and will turn on debug mode or
+      set the cache capacity, engine, commit policy or benchmark */
+   while((option = getopt(arg1, arg2, "xc:e:b:s")) != EOF)
    {
       switch (option)
       {
          case 'x': /* Turn on if x is found in argument */
             debugOn();
          break;
+
+         case 'c': /* Cache capacity follows c */
+            lookupCache().setCapacity(strtoul(optarg, NULL, 10));
+         break;
+
+         case 'e': /* Storage engine follows e */
+            engineOption = optarg;
+         break;
+
+         case 'b': /* Clients per engine for the benchmark follow b */
+            benchmarkClients = strtol(optarg, NULL, 10);
+         break;
+
+         case 's': /* Flush every commit to the device */
+            ioEngine().setCommitSync(true);
+         break;
       }
    }
 }
+
+/*-----------------------------------------------------------------------------
+Name:        printBenchmark
+
+Description: Print the timings of a benchmark.
+
+Algorithm:   Prints a table with a row per engine and a column per step, in
+             seconds, then the commit policy every engine ran with.
+
+Parameters:  results: timings of each engine
+
+Output:      void
+
+Result:      The table is printed to stdout.
+-----------------------------------------------------------------------------*/
+void printBenchmark(const vector<BenchmarkResult> &results)
+{
+   cout << left << setw(10) << "Engine" << right << setw(13) << "Inserts (s)"
+        << setw(13) << "Hits (s)" << setw(13) << "Misses (s)" << setw(13)
+        << "Write (s)" << setw(13) << "Reset (s)" << "\n" << fixed
+        << setprecision(4);
+
+   for(size_t row = 0; row < results.size(); row++)
+      cout << left << setw(10) << results[row].engine << right << setw(13)
+           << results[row].inserts << setw(13) << results[row].hits
+           << setw(13) << results[row].misses << setw(13)
+           << results[row].write << setw(13) << results[row].reset << "\n";
+
+   cout << "Commits flushed to disk by every engine: "
+        << (ioEngine().getCommitSync() ? "on every insert (-s)" :
+                                         "on generation swaps and at exit")
+        << "\n";
+
+   cout.unsetf(ios :: fixed);
+   cout << setprecision(6) << flush;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        printMatches
+
+Description: Print the clients found by a name query.
+
+Algorithm:   Prints the occupant number and name of every client, in name
+             order, and then how many were found.
+
+Parameters:  matches: the clients found
+
+Output:      void
+
+Result:      The clients are printed to stdout.
+------------------------------------------------------------------------------*/
+void printMatches(const vector<NameEntry> &matches)
+{
+   for(size_t match = 0; match < matches.size(); match++)
+      cout << setw(10) << matches[match].occupant << "  "
+           << matches[match].name << endl;
+
+   cout << matches.size() << " client(s) found." << endl;
+}
@@ -0,0 +1,550 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Ingest.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the class Ingestor. A CSV or
+             TSV file is mapped into memory and parsed in parallel one window
+             at a time. Valid clients are appended to the datafile in input
+             order and rejected rows are written to a side file along with the
+             reason they were rejected.
+#############################################################################*/
+#include<chrono>
+#include<cstring>
+#include<cctype>
+#include<functional>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "Ingest.h"
+#include "AsyncIO.h"
+#include "Schema.h"
+#include "LookupCache.h"
+#include "Version.h"
+#include "Scheduler.h"
+
+/* Sizes used while ingesting */
+static const size_t INGEST_WINDOW = 32 << 20; /* bytes parsed between appends */
+static const size_t SLICE_MINIMUM = 1 << 16;  /* smallest slice given its own
+                                                 task */
+
+/* Reasons a row is rejected */
+static const char BAD_QUOTES[] = "unbalanced quotes";
+static const char BAD_FIELD_COUNT[] = "expected name, I.D. and birthday";
+static const char BAD_NAME[] = "name is empty or contains whitespace";
+static const char LONG_NAME[] = "name is too long";
+static const char BAD_IDENTIFICATION[] = "I.D. is not in form Axxxxxxxx";
+static const char BAD_BIRTHDAY[] = "birthday is not in form xxxxxx";
+
+/* Debug messages */
+static const char CREATE_INGESTOR[] = "[Ingestor object has been created]\n";
+static const char DESTROY_INGESTOR[] =
+   "[Ingestor object has been deallocated]\n";
+static const char INGEST[] = "[Ingesting... ";
+
+/*-----------------------------------------------------------------------------
+Name:        isDigits
+
+Description: Whether a string is made only of decimal digits.
+
+Algorithm:   Checks every character.
+
+Parameters:  text: the string to check
+
+Output:      true when text is non empty and all digits
+
+Result:      Status is returned.
+------------------------------------------------------------------------------*/
+static bool isDigits(const string &text)
+{
+   if(text.empty())
+      return false;
+
+   for(size_t at = 0; at < text.size(); at++)
+      if(!isdigit(static_cast<unsigned char>(text[at])))
+         return false;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        Ingestor
+
+Description: Default constructor.
+
+Algorithm:   Parses on every worker of the scheduler plus the calling thread,
+             with a comma delimiter until a file says otherwise. Outputs prompt
+             of being called if debug is on.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Ingestor object is allocated.
+------------------------------------------------------------------------------*/
+Ingestor :: Ingestor() :
+            delimiter(','), threads(scheduler().getWorkers() + 1)
+{
+   /* Debug message */
+   if(debug)
+      cerr << CREATE_INGESTOR;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~Ingestor
+
+Description: Destructor.
+
+Algorithm:   Outputs prompt of being called if debug is on.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Ingestor object is deallocated.
+------------------------------------------------------------------------------*/
+Ingestor :: ~Ingestor()
+{
+   /* Debug message */
+   if(debug)
+      cerr << DESTROY_INGESTOR;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        splitFields
+
+Description: Split one line into its fields.
+
+Algorithm:   Fields are separated by delimiter. A field starting with a double
+             quote runs to the closing quote, with two quotes standing for one,
+             and may contain the delimiter. Spaces around unquoted fields are
+             dropped.
+
+Parameters:  begin:  first character of the line
+             end:    end of the line, without the new line
+             fields: the fields of the line
+
+Output:      false when a quoted field is not closed properly
+
+Result:      fields holds every field of the line.
+------------------------------------------------------------------------------*/
+bool Ingestor :: splitFields(const char *begin, const char *end,
+                             vector<string> &fields) const
+{
+   const char *at = begin; /* current character */
+
+   fields.clear();
+   for(;;)
+   {
+      string field; /* field being read */
+
+      while(at < end && *at == ' ')
+         at++;
+
+      if(at < end && *at == '"')
+      {
+         /* Quoted field */
+         for(at++; ; at++)
+         {
+            if(at >= end)
+               return false;
+            if(*at == '"')
+            {
+               if(at + 1 < end && at[1] == '"')
+                  at++;
+               else
+                  break;
+            }
+            field += *at;
+         }
+         for(at++; at < end && *at == ' '; at++)
+            ;
+         if(at < end && *at != delimiter)
+            return false;
+      }
+      else
+      {
+         /* Plain field */
+         const char *fieldEnd = at;
+         while(fieldEnd < end && *fieldEnd != delimiter)
+            fieldEnd++;
+
+         const char *last = fieldEnd;
+         while(last > at && last[-1] == ' ')
+            last--;
+
+         field.assign(at, last - at);
+         at = fieldEnd;
+      }
+
+      fields.push_back(field);
+      if(at >= end)
+         break;
+      at++;
+   }
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        validate
+
+Description: Check one row's fields.
+
+Algorithm:   A row needs exactly a name, an I.D. and a birthday. The name must
+             fit NAME_CHARACTERS and hold no whitespace, since the datafile
+             separates its fields by whitespace. The I.D. must be an A followed
+             by eight digits and the birthday must be BIRTHDAY_CHARACTERS
+             digits.
+
+Parameters:  fields: the fields of the row
+
+Output:      reason: why the row is rejected, or NULL when it is valid
+
+Result:      Reason is returned.
+------------------------------------------------------------------------------*/
+const char * Ingestor :: validate(const vector<string> &fields) const
+{
+   if(fields.size() != 3)
+      return BAD_FIELD_COUNT;
+
+   const string &name = fields[0];
+   const string &identification = fields[1];
+   const string &birthday = fields[2];
+
+   if(name.empty())
+      return BAD_NAME;
+   for(size_t at = 0; at < name.size(); at++)
+      if(isspace(static_cast<unsigned char>(name[at])))
+         return BAD_NAME;
+   if(name.size() > static_cast<size_t>(NAME_CHARACTERS))
+      return LONG_NAME;
+
+   if(identification.size() != static_cast<size_t>(IDENTIFICATION_CHARACTERS) ||
+      identification[0] != 'A' || !isDigits(identification.substr(1)))
+      return BAD_IDENTIFICATION;
+
+   if(birthday.size() != static_cast<size_t>(BIRTHDAY_CHARACTERS) ||
+      !isDigits(birthday))
+      return BAD_BIRTHDAY;
+
+   /* Return value */
+   return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        parseSlice
+
+Description: Parse and validate the lines of a slice.
+
+Algorithm:   Every line is split into fields and validated. Blank lines are
+             skipped. The first line of the file is taken as a header and
+             skipped when its birthday column is not a number. Valid rows
+             become records and the rest become rejects.
+
+Parameters:  slice: the slice to parse
+
+Output:      void
+
+Result:      slice holds its records, rejects and line count.
+------------------------------------------------------------------------------*/
+void Ingestor :: parseSlice(IngestSlice &slice) const
+{
+   const char *at = slice.begin; /* start of the current line */
+   vector<string> fields;        /* fields of the current line */
+   ClientRecord record;          /* client of the current line */
+
+   slice.lines = 0;
+   record.occupant = 0;
+
+   while(at < slice.end)
+   {
+      const char *lineEnd = static_cast<const char *>(
+                               memchr(at, '\n', slice.end - at));
+      const char *next;
+
+      if(lineEnd == NULL)
+         lineEnd = slice.end;
+      next = lineEnd + 1;
+      if(lineEnd > at && lineEnd[-1] == '\r')
+         lineEnd--;
+
+      bool isHeader = slice.firstLine && slice.lines == 0;
+      slice.lines++;
+
+      if(lineEnd > at)
+      {
+         const char *reason = BAD_QUOTES;
+
+         if(splitFields(at, lineEnd, fields))
+         {
+            if(isHeader && fields.size() == 3 && !isDigits(fields[2]))
+               reason = "";
+            else
+               reason = validate(fields);
+         }
+
+         if(reason == NULL)
+         {
+            record.name = fields[0];
+            record.identification = fields[1];
+            record.birthday = atoi(fields[2].c_str());
+            slice.records.push_back(record);
+         }
+         else if(*reason != '\0')
+            slice.rejects.push_back(make_pair(slice.lines,
+                                    string(reason) + '\t' +
+                                    string(at, lineEnd - at)));
+      }
+
+      at = next;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        formatSlice
+
+Description: Format the accepted clients of a slice as rows.
+
+Algorithm:   Gives the clients consecutive occupant numbers and formats each
+             one as a datafile row.
+
+Parameters:  slice:         the slice to format
+             firstOccupant: occupant number of the slice's first client
+
+Output:      void
+
+Result:      slice.rows holds the rows to append.
+------------------------------------------------------------------------------*/
+void Ingestor :: formatSlice(IngestSlice &slice, int firstOccupant) const
+{
+   slice.rows.reserve(slice.records.size() * 64);
+
+   for(size_t at = 0; at < slice.records.size(); at++)
+   {
+      slice.records[at].occupant = firstOccupant + at;
+      ClientSchema :: appendRow(slice.rows, slice.records[at]);
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ingest
+
+Description: Append every valid row of a file to the database.
+
+Algorithm:   The file is mapped into memory with a sequential access hint. A
+             file ending in .tsv, or whose first line has tabs but no commas,
+             is read as TSV. The file is handled one window at a time; each
+             window is cut on line boundaries into a slice per thread. The
+             slices are parsed as foreground tasks of the scheduler, occupant
+             numbers are handed out in input order from the current occupancy,
+             and the rows are formatted the same way. The rows are then
+             streamed to the end of the datafile and the rejects to
+             path.rejects, the lookup cache is told of each new client, and
+             progress is reported. The write lock is held throughout, but
+             readers are not blocked: they keep seeing the database as it was
+             until every row is on disk and committed with the new occupancy
+             at the end. A failed ingest, or one that cannot take the write
+             lock, commits nothing, and a failure after the cache was told of
+             new clients clears it.
+
+Parameters:  path:   CSV or TSV file to ingest
+             report: counts, size and time of the ingest
+
+Output:      false when the file could not be read or the database written
+
+Result:      Every valid row of path is in the database.
+------------------------------------------------------------------------------*/
+bool Ingestor :: ingest(const string &path, IngestReport &report)
+{
+   /* Debug message */
+   if(debug)
+      cerr << INGEST << path << "]" << endl;
+
+   chrono :: steady_clock :: time_point start = chrono :: steady_clock :: now();
+   StreamWriter rows,        /* appends to the datafile */
+                rejectFile;  /* writes the rejected rows */
+   struct stat info;         /* size of the input file */
+   int occupant;             /* last occupant number handed out */
+   long line = 0;            /* lines before the current window */
+   Manifest pending;         /* commit record as of the record being noted */
+   bool isWritten;           /* every row and reject reached the disk */
+
+   report.accepted = 0;
+   report.rejected = 0;
+   report.bytes = 0;
+   report.seconds = 0;
+   report.rejects = path + ".rejects";
+
+   /* Map the input */
+   int fd = open(path.c_str(), O_RDONLY);
+   if(fd < 0)
+      return false;
+   if(fstat(fd, &info) < 0)
+   {
+      close(fd);
+      return false;
+   }
+   report.bytes = info.st_size;
+
+   const char *data = NULL;
+   if(report.bytes > 0)
+   {
+      void *mapping = mmap(NULL, report.bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(mapping == MAP_FAILED)
+      {
+         close(fd);
+         return false;
+      }
+      madvise(mapping, report.bytes, MADV_SEQUENTIAL);
+      data = static_cast<const char *>(mapping);
+   }
+   const char *end = data + report.bytes;
+
+   /* Pick the delimiter */
+   const char *firstEnd = data ? static_cast<const char *>(
+                                    memchr(data, '\n', report.bytes)) : NULL;
+   if(firstEnd == NULL)
+      firstEnd = end;
+   if(path.size() >= 4 && path.compare(path.size() - 4, 4, ".tsv") == 0)
+      delimiter = '\t';
+   else if(data && memchr(data, '\t', firstEnd - data) &&
+           !memchr(data, ',', firstEnd - data))
+      delimiter = '\t';
+   else
+      delimiter = ',';
+
+   WriteLock writer; /* excludes other writers until the rows are committed */
+
+   if(!writer.isHeld() || !rows.openAppend(writer.getManifest().file) ||
+      !rejectFile.open(report.rejects))
+   {
+      if(data)
+         munmap(const_cast<char *>(data), report.bytes);
+      close(fd);
+      return false;
+   }
+   pending = writer.getManifest();
+   occupant = pending.occupancy;
+
+   /* One window at a time */
+   for(const char *window = data; window < end; )
+   {
+      const char *windowEnd = end;
+      if(static_cast<size_t>(end - window) > INGEST_WINDOW)
+      {
+         windowEnd = static_cast<const char *>(
+                        memchr(window + INGEST_WINDOW, '\n',
+                               end - window - INGEST_WINDOW));
+         windowEnd = windowEnd ? windowEnd + 1 : end;
+      }
+
+      /* Cut the window into slices on line boundaries */
+      size_t sliceCount = (windowEnd - window) / SLICE_MINIMUM + 1;
+      if(sliceCount > threads)
+         sliceCount = threads;
+      size_t sliceBytes = (windowEnd - window) / sliceCount + 1;
+
+      vector<IngestSlice> slices(sliceCount);
+      const char *sliceStart = window;
+      for(size_t at = 0; at < sliceCount; at++)
+      {
+         const char *sliceEnd = windowEnd;
+         if(at + 1 < sliceCount &&
+            static_cast<size_t>(windowEnd - sliceStart) > sliceBytes)
+         {
+            sliceEnd = static_cast<const char *>(
+                          memchr(sliceStart + sliceBytes, '\n',
+                                 windowEnd - sliceStart - sliceBytes));
+            sliceEnd = sliceEnd ? sliceEnd + 1 : windowEnd;
+         }
+
+         slices[at].begin = sliceStart;
+         slices[at].end = sliceEnd;
+         slices[at].firstLine = sliceStart == data;
+         sliceStart = sliceEnd;
+      }
+
+      /* Parse the slices in parallel */
+      scheduler().parallelFor(FOREGROUND, 0, sliceCount, 1,
+                              [this, &slices](size_t first, size_t last)
+                              {
+                                 for(size_t at = first; at < last; at++)
+                                    parseSlice(slices[at]);
+                              });
+
+      /* Hand out occupant numbers in order and format in parallel */
+      vector<int> firstOccupant(sliceCount);
+      for(size_t at = 0; at < sliceCount; at++)
+      {
+         firstOccupant[at] = occupant + 1;
+         occupant += slices[at].records.size();
+      }
+      scheduler().parallelFor(FOREGROUND, 0, sliceCount, 1,
+                              [this, &slices, &firstOccupant](size_t first,
+                                                              size_t last)
+                              {
+                                 for(size_t at = first; at < last; at++)
+                                    formatSlice(slices[at], firstOccupant[at]);
+                              });
+
+      /* Append in input order */
+      for(size_t at = 0; at < sliceCount; at++)
+      {
+         IngestSlice &slice = slices[at];
+
+         rows.write(slice.rows);
+         for(size_t record = 0; record < slice.records.size(); record++)
+         {
+            pending.occupancy = slice.records[record].occupant;
+            lookupCache().noteInsert(slice.records[record], pending);
+         }
+         for(size_t reject = 0; reject < slice.rejects.size(); reject++)
+         {
+            ostringstream text;
+            text << "line " << line + slice.rejects[reject].first << '\t'
+                 << slice.rejects[reject].second << '\n';
+            rejectFile.write(text.str());
+         }
+
+         report.accepted += slice.records.size();
+         report.rejected += slice.rejects.size();
+         line += slice.lines;
+      }
+
+      window = windowEnd;
+
+      /* Progress */
+      cout << "\rIngested " << (window - data) / 1048576 << " of "
+           << report.bytes / 1048576 << " MB ("
+           << (window - data) * 100 / report.bytes << "%), "
+           << report.accepted << " client(s)" << flush;
+   }
+   if(report.bytes > 0)
+      cout << endl;
+
+   isWritten = rows.close();
+   isWritten = rejectFile.close() && isWritten;
+   if(data)
+      munmap(const_cast<char *>(data), report.bytes);
+   close(fd);
+
+   /* Commit the new occupancy once every row is on disk; if nothing was
+      committed the lookups noted above are wrong */
+   if(isWritten)
+      isWritten = commitAppend(occupant);
+   if(!isWritten)
+      lookupCache().clear();
+
+   report.seconds = chrono :: duration<double>(chrono :: steady_clock :: now() -
+                                               start).count();
+
+   /* Return value */
+   return isWritten;
+}
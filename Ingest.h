@@ -0,0 +1,107 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Ingest.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definition of the class
+             Ingestor, which bulk loads clients from CSV or TSV files.
+#############################################################################*/
+#ifndef INGEST_H
+#define INGEST_H
+
+#include<string>
+#include<vector>
+#include "Client.h"
+
+using namespace std;
+
+/*=============================================================================
+Struct:      IngestReport
+
+Description: Outcome of one ingest.
+
+DataFields:  accepted: clients appended to the database
+             rejected: rows written to the rejects file
+             bytes:    size of the input file
+             seconds:  time taken by the whole ingest
+             rejects:  file the rejected rows were written to
+=============================================================================*/
+struct IngestReport
+{
+   long accepted,
+        rejected;
+   size_t bytes;
+   double seconds;
+   string rejects;
+};
+
+/*=============================================================================
+Struct:      IngestSlice
+
+Description: The part of a window parsed by one thread.
+
+DataFields:  begin, end: bytes of the slice; both lie on line starts
+             firstLine:  whether the slice starts the input file
+             lines:      amount of lines in the slice
+             records:    valid clients in input order
+             rejects:    rejected rows as text for the rejects file, each
+                         tagged with its line number within the slice
+             rows:       datafile rows formatted from records
+=============================================================================*/
+struct IngestSlice
+{
+   const char *begin,
+              *end;
+   bool firstLine;
+   long lines;
+   vector<ClientRecord> records;
+   vector<pair<long, string> > rejects;
+   string rows;
+};
+
+/*=============================================================================
+Class:       Ingestor
+
+Description: Reads a CSV or TSV file of clients, one per line as name, I.D.
+             and birthday. The file is mapped into memory and handled in
+             windows. Each window is split into slices that the scheduler's
+             workers parse and validate; occupant numbers are then given out in
+             input order and the workers format the rows, which are appended
+             through the bulk write path. A header line is skipped and invalid
+             rows are written to a side file.
+
+DataFields:  delimiter: separator between fields
+             threads:   amount of threads parsing, and of slices per window
+
+Functions:   Ingestor:    constructor
+             ~Ingestor:   destructor
+             ingest:      append every valid row of a file to the database
+             parseSlice:  parse and validate the lines of a slice
+             formatSlice: format the accepted clients of a slice as rows
+             splitFields: split one line into its fields
+             validate:    check one row's fields
+=============================================================================*/
+class Ingestor
+{
+   private:
+      char delimiter;
+      unsigned threads;
+
+      void parseSlice(IngestSlice &) const;
+      void formatSlice(IngestSlice &, int) const;
+      bool splitFields(const char *, const char *, vector<string> &) const;
+      const char * validate(const vector<string> &) const;
+
+   public:
+      /* Constructor and destructor */
+      Ingestor();
+      ~Ingestor();
+
+      /* Bulk load */
+      bool ingest(const string &, IngestReport &);
+};
+
+#endif
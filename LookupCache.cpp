@@ -0,0 +1,428 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  LookupCache.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the class LookupCache. Entries
+             are kept in a list ordered by use with a hash index by name, so
+             finding, storing and evicting are all constant time.
+#############################################################################*/
+#include "LookupCache.h"
+
+/* Entries kept when no capacity is given on the command line */
+static const size_t DEFAULT_CACHE_CAPACITY = 4096;
+
+/*-----------------------------------------------------------------------------
+Name:        LookupCache
+
+Description: Constructor.
+
+Algorithm:   Starts empty with the given capacity and an unknown commit record.
+
+Parameters:  most: most entries kept
+
+Output:      none
+
+Result:      LookupCache object is allocated.
+------------------------------------------------------------------------------*/
+LookupCache :: LookupCache(size_t most) :
+               capacity(most), generation(0), occupancy(-1), hits(0), misses(0),
+               invalidations(0)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~LookupCache
+
+Description: Destructor.
+
+Algorithm:   Nothing to release beyond the datafields.
+
+Parameters:  none
+
+Output:      none
+
+Result:      LookupCache object is deallocated.
+------------------------------------------------------------------------------*/
+LookupCache :: ~LookupCache()
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        trim
+
+Description: Drop least recently used entries beyond capacity.
+
+Algorithm:   Removes entries from the back of the list until it fits. Must be
+             called with lock held.
+
+Parameters:  none
+
+Output:      void
+
+Result:      At most capacity entries are held.
+------------------------------------------------------------------------------*/
+void LookupCache :: trim(void)
+{
+   while(entries.size() > capacity)
+   {
+      index.erase(entries.back().name);
+      entries.pop_back();
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        find
+
+Description: Look for a cached result.
+
+Algorithm:   On a hit the entry is moved to the front of the list and its
+             result copied out. Hits and misses are counted.
+
+Parameters:  name:    the name to look up
+             isFound: cached result
+             record:  cached client when isFound is true
+
+Output:      true on a hit
+
+Result:      isFound and record are set on a hit.
+------------------------------------------------------------------------------*/
+bool LookupCache :: find(const string &name, bool &isFound,
+                         ClientRecord &record)
+{
+   lock_guard<mutex> guard(lock);
+   unordered_map<string, list<CacheEntry> :: iterator> :: iterator found =
+      index.find(name);
+
+   if(found == index.end())
+   {
+      misses++;
+      return false;
+   }
+
+   entries.splice(entries.begin(), entries, found->second);
+   isFound = found->second->isFound;
+   if(isFound)
+      record = found->second->record;
+   hits++;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        store
+
+Description: Remember a result read from the datafile.
+
+Algorithm:   The result is only kept if the commit record it was read at is the
+             one the cache is valid for; a cache with an unknown commit record
+             adopts it. The entry goes to the front of the list, replacing an
+             older entry for the name, and the list is trimmed.
+
+Parameters:  name:    the name looked up
+             isFound: whether a client was found
+             record:  the client found
+             current: commit record of the snapshot that was searched
+
+Output:      void
+
+Result:      The result is cached.
+------------------------------------------------------------------------------*/
+void LookupCache :: store(const string &name, bool isFound,
+                          const ClientRecord &record, const Manifest &current)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(capacity == 0)
+      return;
+   if(occupancy < 0)
+   {
+      generation = current.generation;
+      occupancy = current.occupancy;
+   }
+   if(generation != current.generation || occupancy != current.occupancy)
+      return;
+
+   unordered_map<string, list<CacheEntry> :: iterator> :: iterator found =
+      index.find(name);
+   if(found != index.end())
+   {
+      entries.erase(found->second);
+      index.erase(found);
+   }
+
+   CacheEntry entry;
+   entry.name = name;
+   entry.isFound = isFound;
+   entry.record = record;
+   entries.push_front(entry);
+   index[name] = entries.begin();
+
+   trim();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        noteInsert
+
+Description: Account for a client appended by this process.
+
+Algorithm:   Only a cached not found result for the client's name can change,
+             and it becomes found with the new client; every other entry stays
+             valid. The cache then moves to the new commit record. If the cache
+             was not valid for the commit record just before the insert it is
+             cleared instead.
+
+Parameters:  record:  the client appended
+             current: commit record after the insert
+
+Output:      void
+
+Result:      The cache matches the database again.
+------------------------------------------------------------------------------*/
+void LookupCache :: noteInsert(const ClientRecord &record,
+                               const Manifest &current)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(occupancy >= 0 && (generation != current.generation ||
+                         occupancy != current.occupancy - 1))
+   {
+      invalidations += entries.size();
+      entries.clear();
+      index.clear();
+   }
+   else
+   {
+      unordered_map<string, list<CacheEntry> :: iterator> :: iterator found =
+         index.find(record.name);
+      if(found != index.end() && !found->second->isFound)
+      {
+         found->second->isFound = true;
+         found->second->record = record;
+         invalidations++;
+      }
+   }
+
+   generation = current.generation;
+   occupancy = current.occupancy;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        validate
+
+Description: Clear the cache if the database changed elsewhere.
+
+Algorithm:   Compares the current commit record with the one the cache is
+             valid for and clears every entry when they differ.
+
+Parameters:  current: commit record read from the database
+
+Output:      void
+
+Result:      Every entry is valid for current.
+------------------------------------------------------------------------------*/
+void LookupCache :: validate(const Manifest &current)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(generation != current.generation || occupancy != current.occupancy)
+   {
+      invalidations += entries.size();
+      entries.clear();
+      index.clear();
+      generation = current.generation;
+      occupancy = current.occupancy;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        clear
+
+Description: Drop every entry.
+
+Algorithm:   Empties the list and index and forgets the commit record.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The cache is empty.
+------------------------------------------------------------------------------*/
+void LookupCache :: clear(void)
+{
+   lock_guard<mutex> guard(lock);
+
+   invalidations += entries.size();
+   entries.clear();
+   index.clear();
+   occupancy = -1;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        setCapacity
+
+Description: Change the most entries kept.
+
+Algorithm:   Assigns most to capacity and trims.
+
+Parameters:  most: most entries kept; 0 turns the cache off
+
+Output:      void
+
+Result:      Capacity is set.
+------------------------------------------------------------------------------*/
+void LookupCache :: setCapacity(size_t most)
+{
+   lock_guard<mutex> guard(lock);
+
+   capacity = most;
+   trim();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getCapacity
+
+Description: Getter for capacity.
+
+Algorithm:   Returns capacity.
+
+Parameters:  none
+
+Output:      capacity: most entries kept
+
+Result:      Capacity is returned.
+------------------------------------------------------------------------------*/
+size_t LookupCache :: getCapacity(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   return capacity;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getSize
+
+Description: Amount of entries held.
+
+Algorithm:   Returns the size of the list.
+
+Parameters:  none
+
+Output:      size: entries held
+
+Result:      Size is returned.
+------------------------------------------------------------------------------*/
+size_t LookupCache :: getSize(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   return entries.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getHits
+
+Description: Getter for hits.
+
+Algorithm:   Returns hits.
+
+Parameters:  none
+
+Output:      hits: lookups answered by the cache
+
+Result:      Hits are returned.
+------------------------------------------------------------------------------*/
+long LookupCache :: getHits(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   return hits;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getMisses
+
+Description: Getter for misses.
+
+Algorithm:   Returns misses.
+
+Parameters:  none
+
+Output:      misses: lookups that searched the datafile
+
+Result:      Misses are returned.
+------------------------------------------------------------------------------*/
+long LookupCache :: getMisses(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   return misses;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getInvalidations
+
+Description: Getter for invalidations.
+
+Algorithm:   Returns invalidations.
+
+Parameters:  none
+
+Output:      invalidations: entries changed or dropped by writes
+
+Result:      Invalidations are returned.
+------------------------------------------------------------------------------*/
+long LookupCache :: getInvalidations(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   return invalidations;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        hitRatio
+
+Description: Hits over all lookups.
+
+Algorithm:   Divides hits by hits plus misses; 0 before any lookup.
+
+Parameters:  none
+
+Output:      ratio: between 0 and 1
+
+Result:      Ratio is returned.
+------------------------------------------------------------------------------*/
+double LookupCache :: hitRatio(void) const
+{
+   lock_guard<mutex> guard(lock);
+
+   if(hits + misses == 0)
+      return 0;
+
+   return static_cast<double>(hits) / (hits + misses);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        lookupCache
+
+Description: Cache shared by the whole program.
+
+Algorithm:   Constructs the cache with the default capacity the first time it
+             is asked for.
+
+Parameters:  none
+
+Output:      cache: the shared cache
+
+Result:      The shared cache is returned.
+------------------------------------------------------------------------------*/
+LookupCache & lookupCache(void)
+{
+   static LookupCache cache(DEFAULT_CACHE_CAPACITY);
+
+   return cache;
+}
@@ -0,0 +1,120 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  LookupCache.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definition of the class
+             LookupCache, a bounded cache of lookup results placed in front of
+             Client :: lookup.
+#############################################################################*/
+#ifndef LOOKUPCACHE_H
+#define LOOKUPCACHE_H
+
+#include<string>
+#include<list>
+#include<mutex>
+#include<unordered_map>
+#include "Client.h"
+#include "Version.h"
+
+using namespace std;
+
+/*=============================================================================
+Struct:      CacheEntry
+
+Description: The remembered result of looking up one name.
+
+DataFields:  name:    the name looked up
+             isFound: whether a client with the name exists
+             record:  the first client with the name when isFound is true
+=============================================================================*/
+struct CacheEntry
+{
+   string name;
+   bool isFound;
+   ClientRecord record;
+};
+
+/*=============================================================================
+Class:       LookupCache
+
+Description: Least recently used cache of found and not found lookup results.
+
+             Since a lookup reports the first client with a name, appending a
+             client only changes the result for that client's name, and only
+             when that name was not found before; noteInsert updates just that
+             entry. The generation and occupancy of the commit record the cache
+             was filled at are remembered so that changes made by another
+             process, which the cache cannot see one by one, clear it as a
+             whole.
+
+DataFields:  capacity:      most entries kept
+             entries:       entries, most recently used first
+             index:         entries by name
+             generation:    generation the entries are valid for
+             occupancy:     occupancy the entries are valid for; -1 if unknown
+             hits:          lookups answered by the cache
+             misses:        lookups that had to search the datafile
+             invalidations: entries changed or dropped by writes
+             lock:          guards every datafield
+
+Functions:   LookupCache:  constructor
+             ~LookupCache: destructor
+             find:         look for a cached result and count a hit or miss
+             store:        remember a result from the datafile
+             noteInsert:   account for a client appended by this process
+             validate:     clear the cache if the database changed elsewhere
+             clear:        drop every entry
+             setCapacity:  change the most entries kept
+             getCapacity:  getter for capacity
+             getSize:      amount of entries held
+             getHits:      getter for hits
+             getMisses:    getter for misses
+             getInvalidations: getter for invalidations
+             hitRatio:     hits over all lookups
+             trim:         drop least recently used entries beyond capacity
+=============================================================================*/
+class LookupCache
+{
+   private:
+      size_t capacity;
+      list<CacheEntry> entries;
+      unordered_map<string, list<CacheEntry> :: iterator> index;
+      long generation;
+      int occupancy;
+      long hits,
+           misses,
+           invalidations;
+      mutable mutex lock;
+
+      void trim(void);
+
+   public:
+      /* Constructor and destructor */
+      LookupCache(size_t);
+      ~LookupCache();
+
+      /* Cache operations */
+      bool find(const string &, bool &, ClientRecord &);
+      void store(const string &, bool, const ClientRecord &, const Manifest &);
+      void noteInsert(const ClientRecord &, const Manifest &);
+      void validate(const Manifest &);
+      void clear(void);
+
+      /* Configuration and metrics */
+      void setCapacity(size_t);
+      size_t getCapacity(void) const;
+      size_t getSize(void) const;
+      long getHits(void) const;
+      long getMisses(void) const;
+      long getInvalidations(void) const;
+      double hitRatio(void) const;
+};
+
+/* Cache shared by the whole program */
+LookupCache & lookupCache(void);
+
+#endif
@@ -0,0 +1,2204 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Lsm.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the log structured merge engine: the sorted
+             runs and their writer, and the class LsmEngine, which logs and
+             buffers inserts in a memtable, writes full memtables out as runs
+             and merges runs into levels in the background.
+#############################################################################*/
+#include<cstdio>
+#include<cstring>
+#include<cerrno>
+#include<cctype>
+#include<climits>
+#include<sstream>
+#include<algorithm>
+#include<queue>
+#include<fcntl.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<sys/file.h>
+#include<sys/stat.h>
+#include "Lsm.h"
+#include "Schema.h"
+
+/* Files of the engine; logs and runs are named LSM_PREFIX, their sequence
+   number and LOG_SUFFIX or RUN_SUFFIX */
+static const char LSM_PREFIX[] = "Lsm.";
+static const char LOG_SUFFIX[] = ".log";
+static const char RUN_SUFFIX[] = ".run";
+static const char LSM_MANIFEST[] = "Lsm.manifest";
+static const char LSM_LOCK[] = "Lsm.lock";
+
+/* Layout of a run */
+static const char RUN_MAGIC[] = "DBLSMRUN";        /* first 8 bytes of footer */
+static const uint32_t RUN_VERSION = 1;             /* format version */
+static const size_t RUN_MAGIC_BYTES = 8;           /* length of the magic */
+static const size_t RUN_FOOTER_BYTES = 32;         /* magic, version, blocks,
+                                                      records and index */
+static const size_t RUN_BLOCK_HEADER_BYTES = 12;   /* length, records, crc */
+static const size_t RUN_BLOCK_BYTES = 4096;        /* target payload size */
+
+/* Shape of the tree */
+static const size_t MEMTABLE_BYTES = 4 << 20;      /* memtable size frozen at */
+static const size_t FROZEN_LIMIT = 4;              /* frozen memtables before
+                                                      inserts wait */
+static const size_t LEVEL0_RUNS = 4;               /* level 0 runs merged at */
+static const size_t LEVEL1_BYTES = 32 << 20;       /* size limit of level 1 */
+static const size_t LEVEL_GROWTH = 10;             /* size ratio of levels */
+static const size_t RUN_BYTES = 8 << 20;           /* size of merged runs */
+
+/* Debug messages */
+static const char CREATE_LSM[] = "[LsmEngine object has been created]\n";
+static const char DESTROY_LSM[] = "[LsmEngine object has been deallocated]\n";
+static const char FLUSH[] = "[Flushing memtable to... ";
+static const char MERGE[] = "[Merging level... ";
+static const char INSERT_FAILED[] = "[The client could not be logged]\n";
+static const char RESET_FAILED[] = "[The database could not be reset]\n";
+
+/*=============================================================================
+Struct:      RunCursor
+
+Description: Position in a run while it is merged.
+
+DataFields:  run:     the run read
+             block:   next block to read
+             records: clients of the block read last
+             at:      next client of records
+             failed:  a block could not be read
+=============================================================================*/
+struct RunCursor
+{
+   shared_ptr<SortedRun> run;
+   size_t block;
+   vector<ClientRecord> records;
+   size_t at;
+   bool failed;
+};
+
+/*=============================================================================
+Struct:      HeapOrder
+
+Description: Orders the heads of merged runs so a priority queue yields the
+             lowest key first.
+=============================================================================*/
+struct HeapOrder
+{
+   bool operator()(const pair<ClientRecord, size_t> &left,
+                   const pair<ClientRecord, size_t> &right) const
+   {
+      return RecordOrder()(right.first, left.first);
+   }
+};
+
+/*-----------------------------------------------------------------------------
+Name:        operator()
+
+Description: Key order of the engine.
+
+Algorithm:   Compares names, then occupant numbers.
+
+Parameters:  left:  first client
+             right: second client
+
+Output:      true when left comes before right
+
+Result:      Order is returned.
+------------------------------------------------------------------------------*/
+bool RecordOrder :: operator()(const ClientRecord &left,
+                               const ClientRecord &right) const
+{
+   int names = left.name.compare(right.name); /* order of the names */
+
+   if(names != 0)
+      return names < 0;
+
+   /* Return value */
+   return left.occupant < right.occupant;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        lsmFile
+
+Description: Name of a log or run.
+
+Algorithm:   Joins LSM_PREFIX, the sequence number and the suffix.
+
+Parameters:  sequence: sequence number of the file
+             suffix:   LOG_SUFFIX or RUN_SUFFIX
+
+Output:      path: name of the file
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+static string lsmFile(long sequence, const char *suffix)
+{
+   /* Return value */
+   return LSM_PREFIX + to_string(sequence) + suffix;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readRegion
+
+Description: Read part of an open file.
+
+Algorithm:   Submits one read to the I/O engine and waits for it.
+
+Parameters:  fd:     file to read
+             offset: where the part starts
+             length: amount of bytes
+             data:   the bytes read
+
+Output:      true when every byte was read
+
+Result:      data holds the part.
+------------------------------------------------------------------------------*/
+static bool readRegion(int fd, off_t offset, size_t length, string &data)
+{
+   data.resize(length);
+   if(length == 0)
+      return true;
+
+   /* Return value */
+   return ioEngine().wait(ioEngine().read(fd, &data[0], length, offset)) ==
+          static_cast<long>(length);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        levelLimit
+
+Description: Most bytes a level may hold before it is merged into the next.
+
+Algorithm:   Level 1 holds LEVEL1_BYTES and every deeper level LEVEL_GROWTH
+             times the one above it.
+
+Parameters:  level: the level; 1 or more
+
+Output:      limit: size limit of the level
+
+Result:      Limit is returned.
+------------------------------------------------------------------------------*/
+static size_t levelLimit(int level)
+{
+   size_t limit = LEVEL1_BYTES; /* limit of level 1 */
+
+   for(int deeper = 1; deeper < level; deeper++)
+      limit *= LEVEL_GROWTH;
+
+   /* Return value */
+   return limit;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        sweepStray
+
+Description: Remove logs and runs the manifest does not list.
+
+Algorithm:   Scans the working directory for files named like a log or run,
+             or such a file with ".tmp" after it, and unlinks those not kept.
+             They were left by a crash between writing a file and saving the
+             manifest, or before a retired file was removed.
+
+Parameters:  keep: names of the files the manifest lists
+
+Output:      void
+
+Result:      Only listed logs and runs remain.
+------------------------------------------------------------------------------*/
+static void sweepStray(const set<string> &keep)
+{
+   const size_t PREFIX_LENGTH = strlen(LSM_PREFIX);
+   DIR *directory = opendir("."); /* the working directory */
+   struct dirent *entry;          /* file being considered */
+
+   if(directory == NULL)
+      return;
+
+   while((entry = readdir(directory)) != NULL)
+   {
+      string name = entry->d_name;
+      size_t digits;
+
+      if(name.compare(0, PREFIX_LENGTH, LSM_PREFIX) != 0)
+         continue;
+
+      /* A sequence number must follow the prefix */
+      digits = name.find_first_not_of("0123456789", PREFIX_LENGTH);
+      if(digits == string :: npos || digits == PREFIX_LENGTH)
+         continue;
+
+      string suffix = name.substr(digits);
+      if(suffix != LOG_SUFFIX && suffix != RUN_SUFFIX &&
+         suffix != string(LOG_SUFFIX) + ".tmp" &&
+         suffix != string(RUN_SUFFIX) + ".tmp")
+         continue;
+
+      if(keep.count(name) == 0)
+         unlink(name.c_str());
+   }
+
+   closedir(directory);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        SortedRun
+
+Description: Constructor.
+
+Algorithm:   Records the file; nothing is read until open.
+
+Parameters:  file:   path of the run
+             number: sequence number of the run
+
+Output:      none
+
+Result:      SortedRun object is allocated.
+------------------------------------------------------------------------------*/
+SortedRun :: SortedRun(const string &file, long number) :
+             path(file), sequence(number), fd(-1), records(0), bytes(0),
+             obsolete(false)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~SortedRun
+
+Description: Destructor.
+
+Algorithm:   Closes the file, and removes it once the run has been retired.
+             Runs are shared, so this happens when the last lookup or merge
+             reading a retired run lets go of it.
+
+Parameters:  none
+
+Output:      none
+
+Result:      SortedRun object is deallocated.
+------------------------------------------------------------------------------*/
+SortedRun :: ~SortedRun()
+{
+   if(fd >= 0)
+      close(fd);
+
+   if(obsolete)
+      unlink(path.c_str());
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Read the footer and fence index.
+
+Algorithm:   The footer is read from the end of the file and its magic and
+             version checked. The index it points to must end where the footer
+             starts and match its checksum; it is decoded into one fence per
+             block and the last key.
+
+Parameters:  none
+
+Output:      true when the run is valid
+
+Result:      The run can be searched and read.
+------------------------------------------------------------------------------*/
+bool SortedRun :: open(void)
+{
+   struct stat info;  /* size of the run */
+   string footer,     /* the footer */
+          index;      /* the fence index */
+   uint32_t blocks,   /* amount of blocks */
+            indexOffset,
+            indexLength;
+   const char *at,    /* decoding position */
+              *end;   /* end of the index */
+
+   fd = :: open(path.c_str(), O_RDONLY);
+   if(fd < 0 || fstat(fd, &info) != 0 ||
+      info.st_size < static_cast<off_t>(RUN_FOOTER_BYTES))
+      return false;
+   bytes = info.st_size;
+
+   /* Footer */
+   if(!readRegion(fd, bytes - RUN_FOOTER_BYTES, RUN_FOOTER_BYTES, footer) ||
+      footer.compare(0, RUN_MAGIC_BYTES, RUN_MAGIC) != 0 ||
+      getU32(&footer[8]) != RUN_VERSION)
+      return false;
+
+   blocks = getU32(&footer[12]);
+   records = getU32(&footer[16]);
+   indexOffset = getU32(&footer[20]);
+   indexLength = getU32(&footer[24]);
+
+   if(static_cast<size_t>(indexOffset) + indexLength + RUN_FOOTER_BYTES !=
+         bytes ||
+      !readRegion(fd, indexOffset, indexLength, index) ||
+      crc32(0, index.data(), index.size()) != getU32(&footer[28]))
+      return false;
+
+   /* Fences and last key */
+   at = index.data();
+   end = at + index.size();
+   fences.resize(blocks);
+   for(uint32_t block = 0; block < blocks; block++)
+   {
+      if(!ClientSchema :: decode(at, end, fences[block].key) || end - at < 8)
+         return false;
+      fences[block].offset = getU32(at);
+      fences[block].length = getU32(at + 4);
+      at += 8;
+   }
+
+   /* Return value */
+   return blocks > 0 && ClientSchema :: decode(at, end, last) && at == end;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        find
+
+Description: First client with a name.
+
+Algorithm:   The key range of the name starts just after the key made of the
+             name and the lowest occupant number. The last fence before that
+             key gives the block it starts in; that block is read and, if the
+             range starts at its very end, the next. Nothing is read when the
+             name comes after the last key.
+
+Parameters:  nm:     name of client to search
+             record: the client found
+
+Output:      isFound: whether the run holds a client with the name
+
+Result:      record holds the client with the name and lowest occupant number.
+------------------------------------------------------------------------------*/
+bool SortedRun :: find(const string &nm, ClientRecord &record) const
+{
+   RecordOrder order;              /* key order */
+   ClientRecord probe;             /* start of the name's key range */
+   vector<ClientRecord> clients;   /* clients of a block */
+   size_t block;                   /* block being read */
+
+   probe.occupant = INT_MIN;
+   probe.name = nm;
+   if(fences.empty() || order(last, probe))
+      return false;
+
+   block = upper_bound(fences.begin(), fences.end(), probe,
+                       [&order](const ClientRecord &key, const Fence &fence)
+                       {
+                          return order(key, fence.key);
+                       }) - fences.begin();
+   if(block > 0)
+      block--;
+
+   for(; block < fences.size(); block++)
+   {
+      if(!readBlock(block, clients))
+         return false;
+
+      for(size_t at = 0; at < clients.size(); at++)
+      {
+         int names = clients[at].name.compare(nm);
+
+         if(names == 0)
+         {
+            record = clients[at];
+            return true;
+         }
+         if(names > 0)
+            return false;
+      }
+   }
+
+   /* Return value */
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        scan
+
+Description: Visit clients in key order from a name on.
+
+Algorithm:   Finds the block the name's key range starts in as find does and
+             passes every client from the range on to visit, reading block
+             after block, until visit returns false or the run ends.
+
+Parameters:  nm:    first name visited, if present
+             visit: called with each client; returns whether to go on
+
+Output:      void
+
+Result:      visit has seen the clients from the name on.
+------------------------------------------------------------------------------*/
+void SortedRun :: scan(const string &nm,
+                       const function<bool(const ClientRecord &)> &visit) const
+{
+   RecordOrder order;              /* key order */
+   ClientRecord probe;             /* start of the name's key range */
+   vector<ClientRecord> clients;   /* clients of a block */
+   size_t block;                   /* block being read */
+
+   probe.occupant = INT_MIN;
+   probe.name = nm;
+   if(fences.empty() || order(last, probe))
+      return;
+
+   block = upper_bound(fences.begin(), fences.end(), probe,
+                       [&order](const ClientRecord &key, const Fence &fence)
+                       {
+                          return order(key, fence.key);
+                       }) - fences.begin();
+   if(block > 0)
+      block--;
+
+   for(; block < fences.size(); block++)
+   {
+      if(!readBlock(block, clients))
+         return;
+
+      for(size_t at = 0; at < clients.size(); at++)
+         if(clients[at].name >= nm && !visit(clients[at]))
+            return;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readBlock
+
+Description: Read and decode one block.
+
+Algorithm:   Reads the block its fence points to, checks its length and
+             checksum and decodes every client.
+
+Parameters:  block:   index of the block
+             clients: the clients of the block
+
+Output:      true when the block is intact
+
+Result:      clients holds the block's clients in key order.
+------------------------------------------------------------------------------*/
+bool SortedRun :: readBlock(size_t block, vector<ClientRecord> &clients) const
+{
+   const Fence &fence = fences[block]; /* place of the block */
+   string data;                        /* the block */
+   uint32_t length,                    /* payload bytes */
+            count;                     /* clients in the block */
+
+   clients.clear();
+   if(fence.length < RUN_BLOCK_HEADER_BYTES ||
+      !readRegion(fd, fence.offset, fence.length, data))
+      return false;
+
+   length = getU32(&data[0]);
+   count = getU32(&data[4]);
+   if(length != fence.length - RUN_BLOCK_HEADER_BYTES ||
+      crc32(0, &data[RUN_BLOCK_HEADER_BYTES], length) != getU32(&data[8]))
+      return false;
+
+   const char *at = &data[RUN_BLOCK_HEADER_BYTES];
+   const char *end = at + length;
+
+   clients.resize(count);
+   for(uint32_t client = 0; client < count; client++)
+      if(!ClientSchema :: decode(at, end, clients[client]))
+         return false;
+
+   /* Return value */
+   return at == end;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getBlocks
+
+Description: Amount of blocks.
+
+Algorithm:   Returns the size of fences.
+
+Parameters:  none
+
+Output:      blocks: amount of blocks
+
+Result:      Amount is returned.
+------------------------------------------------------------------------------*/
+size_t SortedRun :: getBlocks(void) const
+{
+   return fences.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getSequence
+
+Description: Getter for sequence.
+
+Algorithm:   Returns sequence.
+
+Parameters:  none
+
+Output:      sequence: sequence number of the run
+
+Result:      Sequence is returned.
+------------------------------------------------------------------------------*/
+long SortedRun :: getSequence(void) const
+{
+   return sequence;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getRecords
+
+Description: Getter for records.
+
+Algorithm:   Returns records.
+
+Parameters:  none
+
+Output:      records: amount of clients
+
+Result:      Records are returned.
+------------------------------------------------------------------------------*/
+long SortedRun :: getRecords(void) const
+{
+   return records;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getBytes
+
+Description: Getter for bytes.
+
+Algorithm:   Returns bytes.
+
+Parameters:  none
+
+Output:      bytes: size of the file
+
+Result:      Bytes are returned.
+------------------------------------------------------------------------------*/
+size_t SortedRun :: getBytes(void) const
+{
+   return bytes;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getFirst
+
+Description: Key of the first client.
+
+Algorithm:   Returns the key of the first fence.
+
+Parameters:  none
+
+Output:      key: the lowest key of the run
+
+Result:      Key is returned.
+------------------------------------------------------------------------------*/
+const ClientRecord & SortedRun :: getFirst(void) const
+{
+   return fences.front().key;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getLast
+
+Description: Key of the last client.
+
+Algorithm:   Returns last.
+
+Parameters:  none
+
+Output:      key: the highest key of the run
+
+Result:      Key is returned.
+------------------------------------------------------------------------------*/
+const ClientRecord & SortedRun :: getLast(void) const
+{
+   return last;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        retire
+
+Description: Mark the run obsolete.
+
+Algorithm:   Sets obsolete; the file is removed when the run is released.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The run will be removed.
+------------------------------------------------------------------------------*/
+void SortedRun :: retire(void)
+{
+   obsolete = true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        RunWriter
+
+Description: Constructor.
+
+Algorithm:   Starts with nothing written.
+
+Parameters:  none
+
+Output:      none
+
+Result:      RunWriter object is allocated.
+------------------------------------------------------------------------------*/
+RunWriter :: RunWriter() : blockRecords(0), offset(0), records(0)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~RunWriter
+
+Description: Destructor.
+
+Algorithm:   Removes the file of a run that was started and not finished.
+
+Parameters:  none
+
+Output:      none
+
+Result:      RunWriter object is deallocated.
+------------------------------------------------------------------------------*/
+RunWriter :: ~RunWriter()
+{
+   if(!path.empty())
+   {
+      out.close();
+      remove((path + ".tmp").c_str());
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Start a run.
+
+Algorithm:   Opens the file the run is written to beside its final name.
+
+Parameters:  file: final name of the run
+
+Output:      true when the file could be opened
+
+Result:      Clients can be added.
+------------------------------------------------------------------------------*/
+bool RunWriter :: open(const string &file)
+{
+   path = file;
+
+   /* Return value */
+   return out.open(path + ".tmp");
+}
+
+/*-----------------------------------------------------------------------------
+Name:        add
+
+Description: Append a client.
+
+Algorithm:   Encodes the client into the current block, which is written out
+             once it reaches RUN_BLOCK_BYTES.
+
+Parameters:  record: the client; its key must follow every key added before
+
+Output:      void
+
+Result:      The client is part of the run.
+------------------------------------------------------------------------------*/
+void RunWriter :: add(const ClientRecord &record)
+{
+   if(blockRecords == 0)
+      first = record;
+
+   ClientSchema :: encode(payload, record);
+   blockRecords++;
+   records++;
+   last = record;
+
+   if(payload.size() >= RUN_BLOCK_BYTES)
+      closeBlock();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        closeBlock
+
+Description: Write out the current block.
+
+Algorithm:   Writes the block header and payload and adds the block's fence.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The current block is empty.
+------------------------------------------------------------------------------*/
+void RunWriter :: closeBlock(void)
+{
+   string header; /* length, records and checksum */
+   Fence fence;   /* place of the block */
+
+   if(blockRecords == 0)
+      return;
+
+   putU32(header, payload.size());
+   putU32(header, blockRecords);
+   putU32(header, crc32(0, payload.data(), payload.size()));
+   out.write(header);
+   out.write(payload);
+
+   fence.key = first;
+   fence.offset = offset;
+   fence.length = header.size() + payload.size();
+   fences.push_back(fence);
+
+   offset += fence.length;
+   payload.clear();
+   blockRecords = 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        finish
+
+Description: Write the index and footer and put the run in place.
+
+Algorithm:   Closes the last block, writes the fence index and the footer
+             describing it and renames the complete file to its final name.
+
+Parameters:  none
+
+Output:      true when the run is in place
+
+Result:      The run can be opened.
+------------------------------------------------------------------------------*/
+bool RunWriter :: finish(void)
+{
+   const string TEMPORARY = path + ".tmp"; /* file written */
+   string index,                           /* the fence index */
+          footer;                          /* the footer */
+
+   closeBlock();
+
+   for(size_t block = 0; block < fences.size(); block++)
+   {
+      ClientSchema :: encode(index, fences[block].key);
+      putU32(index, fences[block].offset);
+      putU32(index, fences[block].length);
+   }
+   ClientSchema :: encode(index, last);
+   out.write(index);
+
+   footer.assign(RUN_MAGIC, RUN_MAGIC_BYTES);
+   putU32(footer, RUN_VERSION);
+   putU32(footer, fences.size());
+   putU32(footer, records);
+   putU32(footer, offset);
+   putU32(footer, index.size());
+   putU32(footer, crc32(0, index.data(), index.size()));
+   out.write(footer);
+   offset += index.size() + footer.size();
+
+   bool isInPlace = out.close() && ioEngine().syncFile(TEMPORARY) &&
+                    rename(TEMPORARY.c_str(), path.c_str()) == 0;
+   if(!isInPlace)
+      remove(TEMPORARY.c_str());
+   path.clear();
+
+   /* Return value */
+   return isInPlace;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getBytes
+
+Description: Bytes written so far.
+
+Algorithm:   Adds the current block to the bytes already written.
+
+Parameters:  none
+
+Output:      bytes: size of the run so far
+
+Result:      Bytes are returned.
+------------------------------------------------------------------------------*/
+size_t RunWriter :: getBytes(void) const
+{
+   return offset + payload.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getRecords
+
+Description: Clients written so far.
+
+Algorithm:   Returns records.
+
+Parameters:  none
+
+Output:      records: clients added
+
+Result:      Records are returned.
+------------------------------------------------------------------------------*/
+long RunWriter :: getRecords(void) const
+{
+   return records;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        advance
+
+Description: Move a merge cursor to its next client.
+
+Algorithm:   Steps through the clients of the current block, reading the next
+             block when they run out.
+
+Parameters:  cursor: the cursor
+
+Output:      true while the cursor is on a client
+
+Result:      cursor.records[cursor.at] is the next client.
+------------------------------------------------------------------------------*/
+static bool advance(RunCursor &cursor)
+{
+   cursor.at++;
+   while(cursor.at >= cursor.records.size())
+   {
+      if(cursor.block >= cursor.run->getBlocks())
+         return false;
+
+      if(!cursor.run->readBlock(cursor.block++, cursor.records))
+      {
+         cursor.failed = true;
+         return false;
+      }
+      cursor.at = 0;
+   }
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        LsmEngine
+
+Description: Constructor.
+
+Algorithm:   Makes sure the scheduler exists first, so that it outlives the
+             engine's background task. Nothing is read until open.
+
+Parameters:  none
+
+Output:      none
+
+Result:      LsmEngine object is allocated.
+------------------------------------------------------------------------------*/
+LsmEngine :: LsmEngine() : lockFd(-1), logFd(-1), logBytes(0),
+                           active(make_shared<Memtable>()), levels(1),
+                           occupants(0), sequence(1), epoch(0),
+                           isMaintaining(false), flushes(0), merges(0),
+                           maintenance(BACKGROUND)
+{
+   scheduler();
+
+   /* Debug message */
+   if(debug)
+      cerr << CREATE_LSM;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~LsmEngine
+
+Description: Destructor.
+
+Algorithm:   Waits for the background task, then flushes the log to the device
+             unless every insert was, closes it and releases the engine's lock
+             file. Frozen memtables not yet written out are kept by their logs.
+
+Parameters:  none
+
+Output:      none
+
+Result:      LsmEngine object is deallocated.
+------------------------------------------------------------------------------*/
+LsmEngine :: ~LsmEngine()
+{
+   scheduler().wait(maintenance);
+
+   if(logFd >= 0)
+   {
+      if(!ioEngine().getCommitSync())
+         fdatasync(logFd);
+      close(logFd);
+   }
+   if(lockFd >= 0)
+      close(lockFd);
+
+   /* Debug message */
+   if(debug)
+      cerr << DESTROY_LSM;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Get the stored database ready for use.
+
+Algorithm:   The lock file is locked without waiting, so a second process
+             fails to open rather than sharing the files. The manifest is read,
+             files it does not list are removed, its runs are opened and its
+             logs replayed into the active memtable in order. Inserts go on
+             appending to the last log when it ends in a whole frame, and to a
+             new log when its end is torn. Logs holding no clients are dropped
+             and removed once the manifest no longer lists them. The manifest
+             is then saved and the background task scheduled if the replayed
+             clients or the levels need it. A missing manifest is an empty
+             database.
+
+Parameters:  none
+
+Output:      true when the engine is ready
+
+Result:      The engine holds every client inserted before it was last closed.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: open(void)
+{
+   lockFd = :: open(LSM_LOCK, O_RDWR | O_CREAT, 0644);
+   if(lockFd < 0 || flock(lockFd, LOCK_EX | LOCK_NB) != 0)
+      return false;
+
+   lock_guard<mutex> guard(lock);
+   istringstream fields(ioEngine().readFile(LSM_MANIFEST)); /* the manifest */
+   string keyword;                 /* first word of a manifest line */
+   vector<long> logs;              /* logs to replay */
+   vector<pair<int, long> > runs;  /* level and sequence of every run */
+   vector<long> empty;             /* logs holding no clients */
+   set<string> keep;               /* files the manifest lists */
+   long saved = 1;                 /* next sequence number saved */
+   bool isIntact = true;           /* the last log ends in a whole frame */
+
+   while(fields >> keyword)
+   {
+      long number;
+      int level;
+
+      if(keyword == "occupancy" && fields >> occupants)
+         continue;
+      if(keyword == "sequence" && fields >> saved)
+         continue;
+      if(keyword == "log" && fields >> number)
+      {
+         logs.push_back(number);
+         keep.insert(lsmFile(number, LOG_SUFFIX));
+         saved = max(saved, number + 1);
+         continue;
+      }
+      if(keyword == "run" && fields >> level >> number && level >= 0)
+      {
+         runs.push_back(make_pair(level, number));
+         keep.insert(lsmFile(number, RUN_SUFFIX));
+         saved = max(saved, number + 1);
+         continue;
+      }
+
+      /* Unknown line */
+      return false;
+   }
+   sequence = saved;
+
+   sweepStray(keep);
+
+   /* Runs */
+   for(size_t run = 0; run < runs.size(); run++)
+   {
+      int level = runs[run].first;
+      shared_ptr<SortedRun> opened =
+         make_shared<SortedRun>(lsmFile(runs[run].second, RUN_SUFFIX),
+                                runs[run].second);
+
+      if(!opened->open())
+         return false;
+      if(levels.size() <= static_cast<size_t>(level))
+         levels.resize(level + 1);
+      levels[level].push_back(opened);
+   }
+   for(size_t level = 1; level < levels.size(); level++)
+      sort(levels[level].begin(), levels[level].end(),
+           [](const shared_ptr<SortedRun> &left,
+              const shared_ptr<SortedRun> &right)
+           {
+              return RecordOrder()(left->getFirst(), right->getFirst());
+           });
+
+   /* Clients not yet written to a run */
+   for(size_t log = 0; log < logs.size(); log++)
+   {
+      bool isLast = log + 1 == logs.size();
+
+      if(replay(logs[log], isIntact) > 0 || (isLast && isIntact))
+         active->logs.push_back(logs[log]);
+      else
+         empty.push_back(logs[log]);
+   }
+
+   if(logs.empty() || !isIntact || !reopenLog(logs.back()))
+      if(!startLog(*active))
+         return false;
+   if(!saveManifest())
+      return false;
+
+   /* The saved manifest no longer lists the empty logs */
+   for(size_t log = 0; log < empty.size(); log++)
+      unlink(lsmFile(empty[log], LOG_SUFFIX).c_str());
+
+   if(active->bytes >= MEMTABLE_BYTES)
+      freeze();
+   schedule();
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        occupancy
+
+Description: Amount of clients in the database.
+
+Algorithm:   Returns occupants.
+
+Parameters:  none
+
+Output:      occupancy: amount of clients
+
+Result:      Occupancy is returned.
+------------------------------------------------------------------------------*/
+int LsmEngine :: occupancy(void)
+{
+   lock_guard<mutex> guard(lock);
+
+   /* Return value */
+   return occupants;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        insert
+
+Description: Add a client with the next occupant number.
+
+Algorithm:   When more than FROZEN_LIMIT memtables are waiting the caller
+             first helps the background task until they are written, so memory
+             stays bounded when inserts outrun the disk; if they still cannot
+             be written the insert fails. Under the lock, the client is given
+             the next occupant number, appended to the log as a frame of its
+             length, checksum and encoding, and added to the active memtable.
+             When the IOEngine asks for every commit to be flushed, the frame
+             is flushed to the device first. A failed or short write, or a
+             failed flush, is cut off the log and fails the insert;
+             should the cut fail too, the log's end is torn and the memtable is
+             frozen before the next insert, so no frame is written after the
+             tear. A memtable that reaches MEMTABLE_BYTES is frozen, a new one
+             started with a new log, and the background task scheduled to write
+             it out. A freeze that fails is tried again by the next insert,
+             which fails while it cannot be done.
+
+Parameters:  nm:   name of client
+             id:   I.D. of client
+             bday: birthday of client
+
+Output:      isInserted: whether the client was logged
+
+Result:      The client is logged and in the memtable.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: insert(const string &nm, const string &id, int bday)
+{
+   ClientRecord record; /* the client being inserted */
+   string payload,      /* encoding of the client */
+          frame;        /* log frame */
+   size_t written = 0;  /* bytes of the frame written */
+   int synced = 0;      /* result of flushing the log */
+   bool isBehind;       /* too many memtables waiting */
+
+   record.name = nm;
+   record.identification = id;
+   record.birthday = bday;
+
+   /* Help write out the waiting memtables, retrying a failed flush */
+   {
+      lock_guard<mutex> guard(lock);
+
+      isBehind = frozen.size() > FROZEN_LIMIT;
+      if(isBehind)
+         schedule();
+   }
+   if(isBehind)
+      scheduler().wait(maintenance);
+
+   lock_guard<mutex> guard(lock);
+
+   if(frozen.size() > FROZEN_LIMIT ||
+      ((active->bytes >= MEMTABLE_BYTES || logBytes < 0) && !freeze()))
+   {
+      if(debug)
+         cerr << INSERT_FAILED;
+      return false;
+   }
+
+   record.occupant = occupants + 1;
+   ClientSchema :: encode(payload, record);
+   putU32(frame, payload.size());
+   putU32(frame, crc32(0, payload.data(), payload.size()));
+   frame += payload;
+   while(written < frame.size())
+   {
+      long moved = ioEngine().wait(ioEngine().write(logFd,
+                                                    frame.data() + written,
+                                                    frame.size() - written,
+                                                    -1));
+      if(moved <= 0)
+         break;
+      written += moved;
+   }
+
+   /* Flush the frame when every commit must reach the device */
+   if(written == frame.size() && ioEngine().getCommitSync())
+      while((synced = fdatasync(logFd)) < 0 && errno == EINTR)
+         ;
+
+   if(written < frame.size() || synced < 0)
+   {
+      /* Replay stops at a partial frame, so nothing may follow one */
+      if(written > 0 && ftruncate(logFd, logBytes) != 0)
+         logBytes = -1;
+      if(debug)
+         cerr << INSERT_FAILED;
+      return false;
+   }
+
+   logBytes += frame.size();
+   occupants = record.occupant;
+   active->records.insert(record);
+   active->bytes += frame.size();
+
+   if(active->bytes >= MEMTABLE_BYTES)
+      freeze();
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        lookup
+
+Description: Find the first client with a name.
+
+Algorithm:   The active memtable is searched under the lock, and the frozen
+             memtables and runs are taken so they stay readable, then searched
+             without it. Every level 0 run may hold the name; in a deeper level
+             only the first run whose last key is not before the name's range
+             can hold its first client. Of the clients found, the one with the
+             lowest occupant number is the first inserted.
+
+Parameters:  nm:     name of client to search
+             record: the client found
+
+Output:      isFound: whether a client with the name exists
+
+Result:      record holds the client found.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: lookup(const string &nm, ClientRecord &record)
+{
+   RecordOrder order;                      /* key order */
+   ClientRecord probe,                     /* start of the name's key range */
+                candidate;                 /* client found in one place */
+   vector<shared_ptr<Memtable> > tables;   /* frozen memtables */
+   LevelList runs;                         /* runs of each level */
+   bool isFound = false;                   /* a client was found */
+
+   probe.occupant = INT_MIN;
+   probe.name = nm;
+
+   {
+      lock_guard<mutex> guard(lock);
+      set<ClientRecord, RecordOrder> :: iterator at =
+         active->records.lower_bound(probe);
+
+      if(at != active->records.end() && at->name == nm)
+      {
+         record = *at;
+         isFound = true;
+      }
+      tables.assign(frozen.begin(), frozen.end());
+      runs = levels;
+   }
+
+   for(size_t table = 0; table < tables.size(); table++)
+   {
+      set<ClientRecord, RecordOrder> :: iterator at =
+         tables[table]->records.lower_bound(probe);
+
+      if(at != tables[table]->records.end() && at->name == nm &&
+         (!isFound || at->occupant < record.occupant))
+      {
+         record = *at;
+         isFound = true;
+      }
+   }
+
+   for(size_t level = 0; level < runs.size(); level++)
+   {
+      size_t first = 0,               /* first run that may hold the name */
+             last = runs[level].size(); /* end of the runs searched */
+
+      if(level > 0)
+      {
+         first = lower_bound(runs[level].begin(), runs[level].end(), probe,
+                             [&order](const shared_ptr<SortedRun> &run,
+                                      const ClientRecord &key)
+                             {
+                                return order(run->getLast(), key);
+                             }) - runs[level].begin();
+         last = min(first + 1, last);
+      }
+
+      for(size_t run = first; run < last; run++)
+         if(runs[level][run]->find(nm, candidate) &&
+            (!isFound || candidate.occupant < record.occupant))
+         {
+            record = candidate;
+            isFound = true;
+         }
+   }
+
+   /* Return value */
+   return isFound;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        prefix
+
+Description: Clients whose names start with a text.
+
+Algorithm:   Collects the names that start with the text.
+
+Parameters:  text:  the prefix; "" matches every name
+             found: the clients, by name and then occupant number
+
+Output:      void
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+void LsmEngine :: prefix(const string &text, vector<NameEntry> &found)
+{
+   collect(text, string(), true, found);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        range
+
+Description: Clients whose names lie between two names.
+
+Algorithm:   Collects the names from first to last, both included.
+
+Parameters:  first: lowest name
+             last:  highest name
+             found: the clients, by name and then occupant number
+
+Output:      void
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+void LsmEngine :: range(const string &first, const string &last,
+                        vector<NameEntry> &found)
+{
+   collect(first, last, false, found);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        collect
+
+Description: Gather the clients of a name query.
+
+Algorithm:   The memtables and runs are taken under the lock as for a lookup.
+             Each memtable and run is read from the start of the first name's
+             key range while the names match. Every level 0 run is read; in a
+             deeper level the runs from the first one that can hold the first
+             name are read, up to one whose first name no longer matches. Keys
+             are unique, so the clients only need sorting.
+
+Parameters:  first:    first name, or the prefix
+             last:     last name of a range
+             isPrefix: whether names must start with first instead of lying
+                       between first and last
+             found:    the clients gathered
+
+Output:      void
+
+Result:      found holds the clients, by name and then occupant number.
+------------------------------------------------------------------------------*/
+void LsmEngine :: collect(const string &first, const string &last,
+                          bool isPrefix, vector<NameEntry> &found)
+{
+   RecordOrder order;                      /* key order */
+   ClientRecord probe;                     /* start of the key range */
+   vector<shared_ptr<Memtable> > tables;   /* every memtable */
+   LevelList runs;                         /* runs of each level */
+
+   /* Whether a name is still part of the query */
+   auto matches = [&](const string &name)
+   {
+      return isPrefix ? name.compare(0, first.size(), first) == 0 :
+                        name <= last;
+   };
+   /* Add a client while it matches */
+   auto visit = [&](const ClientRecord &record)
+   {
+      if(!matches(record.name))
+         return false;
+
+      found.push_back(NameEntry());
+      found.back().name = record.name;
+      found.back().occupant = record.occupant;
+      return true;
+   };
+
+   probe.occupant = INT_MIN;
+   probe.name = first;
+   found.clear();
+
+   {
+      lock_guard<mutex> guard(lock);
+
+      for(set<ClientRecord, RecordOrder> :: iterator at =
+             active->records.lower_bound(probe);
+          at != active->records.end() && visit(*at); ++at)
+         ;
+      tables.assign(frozen.begin(), frozen.end());
+      runs = levels;
+   }
+
+   for(size_t table = 0; table < tables.size(); table++)
+      for(set<ClientRecord, RecordOrder> :: iterator at =
+             tables[table]->records.lower_bound(probe);
+          at != tables[table]->records.end() && visit(*at); ++at)
+         ;
+
+   for(size_t level = 0; level < runs.size(); level++)
+   {
+      size_t run = 0; /* first run that may hold the range */
+
+      if(level > 0)
+         run = lower_bound(runs[level].begin(), runs[level].end(), probe,
+                           [&order](const shared_ptr<SortedRun> &candidate,
+                                    const ClientRecord &key)
+                           {
+                              return order(candidate->getLast(), key);
+                           }) - runs[level].begin();
+
+      for(size_t start = run; run < runs[level].size(); run++)
+      {
+         if(level > 0 && run > start &&
+            !matches(runs[level][run]->getFirst().name))
+            break;
+         runs[level][run]->scan(first, visit);
+      }
+   }
+
+   sort(found.begin(), found.end(),
+        [](const NameEntry &left, const NameEntry &right)
+        {
+           int names = left.name.compare(right.name);
+
+           return names != 0 ? names < 0 : left.occupant < right.occupant;
+        });
+}
+
+/*-----------------------------------------------------------------------------
+Name:        reset
+
+Description: Remove every client.
+
+Algorithm:   Under the lock, a new log is started, every memtable and level is
+             emptied and the manifest saved. If the log cannot be started or
+             the manifest saved, the old database is put back as it was, since
+             the manifest on disk still lists it. Otherwise the epoch is
+             advanced so background work under way is discarded, and the old
+             runs are retired and the old logs removed by a background task,
+             so a reset takes the same time however many clients there were;
+             lookups still reading an old run finish against it.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The database is empty.
+------------------------------------------------------------------------------*/
+void LsmEngine :: reset(void)
+{
+   vector<shared_ptr<SortedRun> > retired; /* runs of the old database */
+   vector<long> logs;                      /* logs of the old database */
+   LevelList oldLevels(1);                 /* levels, once swapped out */
+   deque<shared_ptr<Memtable> > oldFrozen; /* frozen memtables, likewise */
+   shared_ptr<Memtable> oldActive =        /* active memtable, likewise */
+      make_shared<Memtable>();
+   int oldOccupants = 0;                   /* occupancy, likewise */
+
+   lock_guard<mutex> guard(lock);
+
+   int previous = logFd;                /* log of the old active memtable */
+   long long previousBytes = logBytes;  /* its length */
+
+   if(!startLog(*oldActive))
+   {
+      if(debug)
+         cerr << RESET_FAILED;
+      return;
+   }
+
+   /* Swap in the empty database */
+   levels.swap(oldLevels);
+   frozen.swap(oldFrozen);
+   active.swap(oldActive);
+   swap(occupants, oldOccupants);
+
+   if(!saveManifest())
+   {
+      close(logFd);
+      unlink(lsmFile(active->logs.back(), LOG_SUFFIX).c_str());
+      logFd = previous;
+      logBytes = previousBytes;
+
+      levels.swap(oldLevels);
+      frozen.swap(oldFrozen);
+      active.swap(oldActive);
+      swap(occupants, oldOccupants);
+
+      if(debug)
+         cerr << RESET_FAILED;
+      return;
+   }
+   if(previous >= 0)
+      close(previous);
+
+   epoch++;
+   for(size_t level = 0; level < oldLevels.size(); level++)
+      retired.insert(retired.end(), oldLevels[level].begin(),
+                     oldLevels[level].end());
+   for(size_t table = 0; table < oldFrozen.size(); table++)
+      logs.insert(logs.end(), oldFrozen[table]->logs.begin(),
+                  oldFrozen[table]->logs.end());
+   logs.insert(logs.end(), oldActive->logs.begin(), oldActive->logs.end());
+
+   scheduler().submit(maintenance, [retired, logs]() mutable
+      {
+         for(size_t run = 0; run < retired.size(); run++)
+            retired[run]->retire();
+         retired.clear();
+
+         for(size_t log = 0; log < logs.size(); log++)
+            unlink(lsmFile(logs[log], LOG_SUFFIX).c_str());
+      });
+}
+
+/*-----------------------------------------------------------------------------
+Name:        write
+
+Description: Contents of the database as the (w)Write command prints them.
+
+Algorithm:   Every client of the memtables and runs is collected and sorted by
+             occupant number, formatted as the rows of a datafile under the
+             file header, and the whitespace removed as FileManager ::
+             outputFile does, so both engines print the same database alike.
+
+Parameters:  none
+
+Output:      content: the database without its whitespace
+
+Result:      Content is returned.
+------------------------------------------------------------------------------*/
+string LsmEngine :: write(void)
+{
+   vector<ClientRecord> clients,           /* every client */
+                        block;             /* clients of a block */
+   vector<shared_ptr<Memtable> > tables;   /* frozen memtables */
+   LevelList runs;                         /* runs of each level */
+   string content = fileHeader();          /* the formatted database */
+
+   {
+      lock_guard<mutex> guard(lock);
+
+      clients.assign(active->records.begin(), active->records.end());
+      tables.assign(frozen.begin(), frozen.end());
+      runs = levels;
+   }
+
+   for(size_t table = 0; table < tables.size(); table++)
+      clients.insert(clients.end(), tables[table]->records.begin(),
+                     tables[table]->records.end());
+
+   for(size_t level = 0; level < runs.size(); level++)
+      for(size_t run = 0; run < runs[level].size(); run++)
+         for(size_t at = 0; at < runs[level][run]->getBlocks(); at++)
+            if(runs[level][run]->readBlock(at, block))
+               clients.insert(clients.end(), block.begin(), block.end());
+
+   sort(clients.begin(), clients.end(),
+        [](const ClientRecord &left, const ClientRecord &right)
+        {
+           return left.occupant < right.occupant;
+        });
+
+   for(size_t client = 0; client < clients.size(); client++)
+      ClientSchema :: appendRow(content, clients[client]);
+
+   content.erase(remove_if(content.begin(), content.end(),
+                           [](char character)
+                           {
+                              return isspace(
+                                 static_cast<unsigned char>(character));
+                           }),
+                 content.end());
+
+   /* Return value */
+   return content;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        describe
+
+Description: Engine specific metrics for the (s)Stats command.
+
+Algorithm:   Reports the clients in memtables, the runs and bytes of every
+             level, and the flushes and merges done.
+
+Parameters:  none
+
+Output:      text: one line of metrics
+
+Result:      Text is returned.
+------------------------------------------------------------------------------*/
+string LsmEngine :: describe(void)
+{
+   lock_guard<mutex> guard(lock);
+   ostringstream text; /* the metrics */
+   size_t buffered = active->records.size(); /* clients in memtables */
+
+   for(size_t table = 0; table < frozen.size(); table++)
+      buffered += frozen[table]->records.size();
+
+   text << "LSM engine: " << buffered << " client(s) in memtables ("
+        << frozen.size() << " frozen)";
+   for(size_t level = 0; level < levels.size(); level++)
+   {
+      size_t bytes = 0; /* size of the level */
+
+      for(size_t run = 0; run < levels[level].size(); run++)
+         bytes += levels[level][run]->getBytes();
+      text << ", level " << level << ": " << levels[level].size()
+           << " run(s) of " << bytes << " byte(s)";
+   }
+   text << ", " << flushes << " flush(es), " << merges << " merge(s).";
+
+   /* Return value */
+   return text.str();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        hasDataFile
+
+Description: Whether the clients are rows of the datafile.
+
+Algorithm:   Returns false; the clients are in runs.
+
+Parameters:  none
+
+Output:      false
+
+Result:      Status is returned.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: hasDataFile(void) const
+{
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        name
+
+Description: Name of the engine for messages.
+
+Algorithm:   Returns "LSM".
+
+Parameters:  none
+
+Output:      name: the engine's name
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+const char * LsmEngine :: name(void) const
+{
+   return "LSM";
+}
+
+/*-----------------------------------------------------------------------------
+Name:        startLog
+
+Description: Start a new log for a memtable.
+
+Algorithm:   Creates the log under the next sequence number, lists it with the
+             memtable and makes it the log inserts are appended to. The
+             previous log is left open for the caller, which closes it once
+             the manifest lists the new one, or goes back to it should that
+             fail. Must be called with the lock held.
+
+Parameters:  table: the memtable the log belongs to
+
+Output:      true when the log could be created; nothing changes otherwise
+
+Result:      Inserts are appended to the new log.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: startLog(Memtable &table)
+{
+   long number = sequence++; /* sequence number of the log */
+   int fd = :: open(lsmFile(number, LOG_SUFFIX).c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+   if(fd < 0)
+      return false;
+
+   logFd = fd;
+   logBytes = 0;
+   table.logs.push_back(number);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        reopenLog
+
+Description: Append to a replayed log again.
+
+Algorithm:   Opens the log for appending and makes it the log inserts are
+             appended to, with its current size as the bytes written. Must be
+             called with the lock held, and only for a log whose end is a
+             whole frame.
+
+Parameters:  number: sequence number of the log
+
+Output:      true when the log could be opened; nothing changes otherwise
+
+Result:      Inserts are appended to the log.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: reopenLog(long number)
+{
+   int fd = :: open(lsmFile(number, LOG_SUFFIX).c_str(),
+                    O_WRONLY | O_APPEND);
+   off_t size;                /* bytes already in the log */
+
+   if(fd < 0)
+      return false;
+
+   size = lseek(fd, 0, SEEK_END);
+   if(size < 0)
+   {
+      close(fd);
+      return false;
+   }
+
+   logFd = fd;
+   logBytes = size;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        freeze
+
+Description: Freeze the active memtable and start a new one.
+
+Algorithm:   A new memtable is started with a new log, the old one moved to
+             the frozen memtables and the manifest saved, and the background
+             task scheduled to write it out. If the log cannot be created
+             nothing changes. If the manifest cannot be saved, the one on disk
+             lists only the old log, so the new log is removed and inserts go
+             on into the old log and memtable. Must be called with the lock
+             held.
+
+Parameters:  none
+
+Output:      true when the memtable was frozen
+
+Result:      Inserts go to a new, empty memtable.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: freeze(void)
+{
+   shared_ptr<Memtable> fresh = make_shared<Memtable>(); /* next active */
+   int previous = logFd;                /* log of the memtable frozen */
+   long long previousBytes = logBytes;  /* its length */
+
+   if(!startLog(*fresh))
+      return false;
+
+   frozen.push_back(active);
+   active = fresh;
+   if(!saveManifest())
+   {
+      active = frozen.back();
+      frozen.pop_back();
+      close(logFd);
+      unlink(lsmFile(fresh->logs.back(), LOG_SUFFIX).c_str());
+      logFd = previous;
+      logBytes = previousBytes;
+      return false;
+   }
+
+   if(previous >= 0)
+      close(previous);
+   schedule();
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        replay
+
+Description: Add the clients of a log to the active memtable.
+
+Algorithm:   Reads the log frame by frame and stops at the first frame that is
+             cut short or fails its checksum, which is where a crash
+             interrupted the last insert. The occupancy is raised to the
+             highest occupant number replayed. The caller lists the log with
+             the memtable. Must be called with the lock held.
+
+Parameters:  number:   sequence number of the log
+             isIntact: set to whether the log ends in a whole frame
+
+Output:      replayed: amount of clients replayed
+
+Result:      The log's clients are in the active memtable.
+------------------------------------------------------------------------------*/
+long LsmEngine :: replay(long number, bool &isIntact)
+{
+   string content = ioEngine().readFile(lsmFile(number, LOG_SUFFIX));
+   const char *at = content.data();         /* current frame */
+   const char *end = at + content.size();   /* end of the log */
+   long replayed = 0;                       /* clients replayed */
+
+   while(end - at >= 8)
+   {
+      uint32_t length = getU32(at);
+      const char *payload = at + 8;
+      ClientRecord record;
+
+      if(length > static_cast<size_t>(end - payload) ||
+         crc32(0, payload, length) != getU32(at + 4) ||
+         !ClientSchema :: decode(payload, payload + length, record))
+         break;
+
+      active->records.insert(record);
+      active->bytes += 8 + length;
+      occupants = max(occupants, record.occupant);
+      replayed++;
+      at += 8 + length;
+   }
+   isIntact = at == end;
+
+   /* Return value */
+   return replayed;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        saveManifest
+
+Description: Replace the manifest.
+
+Algorithm:   Writes the occupancy, the next sequence number, the logs of every
+             memtable and the level of every run to a temporary file, flushes
+             it to the device and renames it over the manifest, then flushes
+             the directory so the new name survives a power loss. Files the
+             old manifest listed may only be removed after that. Must be
+             called with the lock held.
+
+Parameters:  none
+
+Output:      true when the manifest was replaced and is on the device
+
+Result:      The manifest describes the engine.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: saveManifest(void)
+{
+   const string TEMPORARY = string(LSM_MANIFEST) + ".tmp"; /* file written */
+   ostringstream text; /* the manifest */
+
+   text << "occupancy " << occupants << "\n"
+        << "sequence " << sequence << "\n";
+   for(size_t table = 0; table < frozen.size(); table++)
+      for(size_t log = 0; log < frozen[table]->logs.size(); log++)
+         text << "log " << frozen[table]->logs[log] << "\n";
+   for(size_t log = 0; log < active->logs.size(); log++)
+      text << "log " << active->logs[log] << "\n";
+   for(size_t level = 0; level < levels.size(); level++)
+      for(size_t run = 0; run < levels[level].size(); run++)
+         text << "run " << level << " "
+              << levels[level][run]->getSequence() << "\n";
+
+   /* Return value */
+   return ioEngine().writeFile(TEMPORARY, text.str()) &&
+          ioEngine().syncFile(TEMPORARY) &&
+          rename(TEMPORARY.c_str(), LSM_MANIFEST) == 0 &&
+          ioEngine().syncFile(".");
+}
+
+/*-----------------------------------------------------------------------------
+Name:        schedule
+
+Description: Queue the background task unless it is queued.
+
+Algorithm:   Submits maintain when there is a frozen memtable or a level to
+             merge and the task is neither queued nor running. Must be called
+             with the lock held.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Pending flushes and merges will be done.
+------------------------------------------------------------------------------*/
+void LsmEngine :: schedule(void)
+{
+   if(isMaintaining || (frozen.empty() && mergeLevel() < 0))
+      return;
+
+   isMaintaining = true;
+   scheduler().submit(maintenance, [this]() { maintain(); });
+}
+
+/*-----------------------------------------------------------------------------
+Name:        maintain
+
+Description: Body of the background task.
+
+Algorithm:   Writes out frozen memtables, oldest first, then merges levels
+             until none needs it, deciding under the lock and doing the work
+             without it. The task ends, under the lock, once there is nothing
+             left, so work that arrives later schedules it again. A failure
+             ends the task early; it is retried on the next freeze.
+
+Parameters:  none
+
+Output:      void
+
+Result:      No frozen memtable or oversized level remains.
+------------------------------------------------------------------------------*/
+void LsmEngine :: maintain(void)
+{
+   unique_lock<mutex> guard(lock);
+
+   for(;;)
+   {
+      bool isFlush = !frozen.empty(); /* a memtable is waiting */
+      int level = isFlush ? -1 : mergeLevel(); /* level to merge */
+      bool isDone;                    /* the step succeeded */
+
+      if(!isFlush && level < 0)
+         break;
+
+      guard.unlock();
+      isDone = isFlush ? flush() : merge(level);
+      guard.lock();
+
+      if(!isDone)
+         break;
+   }
+
+   isMaintaining = false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        mergeLevel
+
+Description: Level that should be merged into the next.
+
+Algorithm:   Level 0 once it has LEVEL0_RUNS runs, otherwise the shallowest
+             deeper level holding more than its limit. Must be called with the
+             lock held.
+
+Parameters:  none
+
+Output:      level: the level to merge; -1 if none
+
+Result:      Level is returned.
+------------------------------------------------------------------------------*/
+int LsmEngine :: mergeLevel(void) const
+{
+   if(levels[0].size() >= LEVEL0_RUNS)
+      return 0;
+
+   for(size_t level = 1; level < levels.size(); level++)
+   {
+      size_t bytes = 0; /* size of the level */
+
+      for(size_t run = 0; run < levels[level].size(); run++)
+         bytes += levels[level][run]->getBytes();
+      if(bytes > levelLimit(level))
+         return level;
+   }
+
+   /* Return value */
+   return -1;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        flush
+
+Description: Write the oldest frozen memtable as a level 0 run.
+
+Algorithm:   The memtable is written in key order without the lock, since a
+             frozen memtable never changes. Under the lock again the run is
+             added to level 0, the memtable dropped and the manifest saved;
+             once it is saved the memtable's logs are no longer needed and
+             removed. If a reset happened meanwhile the run is discarded
+             instead.
+
+Parameters:  none
+
+Output:      true unless the run could not be written
+
+Result:      The memtable's clients are in a run.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: flush(void)
+{
+   shared_ptr<Memtable> table;  /* memtable written */
+   shared_ptr<SortedRun> run;   /* the new run */
+   long started,                /* epoch the flush began in */
+        number = sequence++;    /* sequence number of the run */
+   RunWriter writer;            /* writes the run */
+   string path = lsmFile(number, RUN_SUFFIX); /* file of the run */
+
+   {
+      lock_guard<mutex> guard(lock);
+
+      if(frozen.empty())
+         return true;
+      table = frozen.front();
+      started = epoch;
+   }
+
+   /* Debug message */
+   if(debug)
+      cerr << FLUSH << path << "]" << endl;
+
+   if(!table->records.empty())
+   {
+      if(!writer.open(path))
+         return false;
+      for(set<ClientRecord, RecordOrder> :: const_iterator at =
+             table->records.begin(); at != table->records.end(); ++at)
+         writer.add(*at);
+
+      run = make_shared<SortedRun>(path, number);
+      if(!writer.finish() || !run->open())
+      {
+         run->retire();
+         return false;
+      }
+   }
+
+   lock_guard<mutex> guard(lock);
+
+   if(epoch != started || frozen.empty() || frozen.front() != table)
+   {
+      if(run)
+         run->retire();
+      return true;
+   }
+
+   frozen.pop_front();
+   if(run)
+      levels[0].push_back(run);
+   flushes++;
+
+   /* Logs the manifest on disk still lists are kept; the next open replays
+      them, or removes them once a later manifest no longer does */
+   if(!saveManifest())
+      return true;
+   for(size_t log = 0; log < table->logs.size(); log++)
+      unlink(lsmFile(table->logs[log], LOG_SUFFIX).c_str());
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        merge
+
+Description: Merge runs of a level into the next.
+
+Algorithm:   From level 0 every run is taken, since its runs overlap; from a
+             deeper level its first run. The runs of the next level whose keys
+             overlap theirs are added, and all of them merged in key order
+             through a heap of cursors into new runs of about RUN_BYTES each,
+             without the lock. Under the lock again the inputs are replaced by
+             the new runs, the next level kept in key order and the manifest
+             saved; only once it is saved are the inputs retired and removed
+             when no lookup reads them. If the manifest cannot be saved both
+             levels are put back and the new runs discarded, as they are if a
+             reset happened meanwhile.
+
+Parameters:  level: the level to merge from
+
+Output:      true unless a run could not be read or written or the manifest
+             saved
+
+Result:      The level's runs are part of the next level.
+------------------------------------------------------------------------------*/
+bool LsmEngine :: merge(int level)
+{
+   RecordOrder order;                      /* key order */
+   vector<shared_ptr<SortedRun> > inputs,  /* runs merged */
+                                  outputs; /* runs written */
+   vector<RunCursor> cursors;              /* position in every input */
+   priority_queue<pair<ClientRecord, size_t>,
+                  vector<pair<ClientRecord, size_t> >, HeapOrder> heads;
+   unique_ptr<RunWriter> writer;           /* writes the current output */
+   long number = 0;                        /* sequence of the current output */
+   long started;                           /* epoch the merge began in */
+   size_t upper;                           /* inputs from level */
+   bool isWritten = true;                  /* every output was written */
+
+   {
+      lock_guard<mutex> guard(lock);
+
+      if(levels.size() <= static_cast<size_t>(level) || levels[level].empty())
+         return true;
+      if(levels.size() < static_cast<size_t>(level) + 2)
+         levels.resize(level + 2);
+
+      if(level == 0)
+         inputs = levels[0];
+      else
+         inputs.push_back(levels[level].front());
+      upper = inputs.size();
+
+      ClientRecord low = inputs[0]->getFirst(),
+                   high = inputs[0]->getLast();
+      for(size_t run = 1; run < upper; run++)
+      {
+         if(order(inputs[run]->getFirst(), low))
+            low = inputs[run]->getFirst();
+         if(order(high, inputs[run]->getLast()))
+            high = inputs[run]->getLast();
+      }
+
+      for(size_t run = 0; run < levels[level + 1].size(); run++)
+      {
+         const shared_ptr<SortedRun> &next = levels[level + 1][run];
+
+         if(!order(next->getLast(), low) && !order(high, next->getFirst()))
+            inputs.push_back(next);
+      }
+      started = epoch;
+   }
+
+   /* Debug message */
+   if(debug)
+      cerr << MERGE << level << " into " << level + 1 << ", " << inputs.size()
+           << " run(s)]" << endl;
+
+   /* Merge in key order */
+   cursors.resize(inputs.size());
+   for(size_t run = 0; run < inputs.size(); run++)
+   {
+      cursors[run].run = inputs[run];
+      cursors[run].block = 0;
+      cursors[run].at = 0;
+      cursors[run].failed = false;
+      if(advance(cursors[run]))
+         heads.push(make_pair(cursors[run].records[0], run));
+   }
+
+   while(!heads.empty() && isWritten)
+   {
+      size_t run = heads.top().second;
+
+      if(!writer)
+      {
+         number = sequence++;
+         writer.reset(new RunWriter());
+         isWritten = writer->open(lsmFile(number, RUN_SUFFIX));
+      }
+      writer->add(heads.top().first);
+      heads.pop();
+
+      if(advance(cursors[run]))
+         heads.push(make_pair(cursors[run].records[cursors[run].at], run));
+
+      if(writer->getBytes() >= RUN_BYTES || heads.empty())
+      {
+         shared_ptr<SortedRun> output =
+            make_shared<SortedRun>(lsmFile(number, RUN_SUFFIX), number);
+
+         isWritten = isWritten && writer->finish() && output->open();
+         outputs.push_back(output);
+         writer.reset();
+      }
+   }
+
+   for(size_t run = 0; run < cursors.size(); run++)
+      isWritten = isWritten && !cursors[run].failed;
+
+   lock_guard<mutex> guard(lock);
+
+   if(!isWritten || epoch != started)
+   {
+      for(size_t run = 0; run < outputs.size(); run++)
+         outputs[run]->retire();
+      return isWritten;
+   }
+
+   /* Replace the inputs with the outputs, keeping both levels in case the
+      manifest cannot be saved */
+   vector<shared_ptr<SortedRun> > upperRuns,  /* level before the merge */
+                                  lowerRuns;  /* next level before it */
+
+   upperRuns = levels[level];
+   lowerRuns = levels[level + 1];
+
+   for(size_t run = 0; run < inputs.size(); run++)
+   {
+      vector<shared_ptr<SortedRun> > &from =
+         levels[run < upper ? level : level + 1];
+
+      from.erase(std :: remove(from.begin(), from.end(), inputs[run]),
+                 from.end());
+   }
+   levels[level + 1].insert(levels[level + 1].end(), outputs.begin(),
+                            outputs.end());
+   sort(levels[level + 1].begin(), levels[level + 1].end(),
+        [&order](const shared_ptr<SortedRun> &left,
+                 const shared_ptr<SortedRun> &right)
+        {
+           return order(left->getFirst(), right->getFirst());
+        });
+
+   if(!saveManifest())
+   {
+      levels[level].swap(upperRuns);
+      levels[level + 1].swap(lowerRuns);
+      for(size_t run = 0; run < outputs.size(); run++)
+         outputs[run]->retire();
+      return false;
+   }
+
+   /* The manifest no longer lists the inputs */
+   for(size_t run = 0; run < inputs.size(); run++)
+      inputs[run]->retire();
+   merges++;
+
+   /* Return value */
+   return true;
+}
@@ -0,0 +1,315 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Lsm.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definitions of the log
+             structured merge engine. Inserts go to a sorted table in memory,
+             backed by a log, which is written out as an immutable sorted run
+             once full; background merges fold the runs into levels of growing
+             size, and a fence index per run lets a lookup read a single block
+             of each.
+#############################################################################*/
+#ifndef LSM_H
+#define LSM_H
+
+#include<string>
+#include<vector>
+#include<deque>
+#include<set>
+#include<memory>
+#include<mutex>
+#include<atomic>
+#include<functional>
+#include<stdint.h>
+#include "Client.h"
+#include "AsyncIO.h"
+#include "Scheduler.h"
+#include "StorageEngine.h"
+
+using namespace std;
+
+/*=============================================================================
+Struct:      RecordOrder
+
+Description: Key order of the engine: by name, then by occupant number, so the
+             first client with a name is the first of its key range.
+=============================================================================*/
+struct RecordOrder
+{
+   bool operator()(const ClientRecord &, const ClientRecord &) const;
+};
+
+/*=============================================================================
+Struct:      Fence
+
+Description: Entry of a run's fence index.
+
+DataFields:  key:    occupant and name of the first client in the block
+             offset: where the block starts in the run
+             length: bytes of the block including its header
+=============================================================================*/
+struct Fence
+{
+   ClientRecord key;
+   uint32_t offset;
+   uint32_t length;
+};
+
+/*=============================================================================
+Struct:      Memtable
+
+Description: Clients inserted since the last flush, in key order.
+
+DataFields:  records: the clients
+             bytes:   approximate size of the clients once written
+             logs:    sequence numbers of the logs holding the clients
+=============================================================================*/
+struct Memtable
+{
+   set<ClientRecord, RecordOrder> records;
+   size_t bytes;
+   vector<long> logs;
+};
+
+/*=============================================================================
+Class:       SortedRun
+
+Description: An immutable file of clients in key order.
+
+             A run is a series of blocks, each with the same 12 byte header
+             and record encoding as a snapshot block, followed by the fence
+             index and a footer. The index holds, for every block, the key of
+             its first client, its offset and length, and then the key of the
+             run's last client. The 32 byte footer holds the magic string, a
+             version, the amounts of blocks and clients, and the offset, length
+             and CRC-32 of the index. The index is kept in memory while the run
+             is open, so finding a key reads one block, or two when a key range
+             starts at the end of a block.
+
+DataFields:  path:     file of the run
+             sequence: sequence number the file is named after
+             fd:       the open file
+             fences:   first key and place of every block
+             last:     key of the last client
+             records:  amount of clients
+             bytes:    size of the file
+             obsolete: remove the file once the run is released
+
+Functions:   SortedRun:   constructor
+             ~SortedRun:  destructor; removes the file if obsolete
+             open:        read the footer and fence index
+             find:        first client with a name
+             scan:        visit clients in key order from a name on
+             readBlock:   read and decode one block
+             getBlocks:   amount of blocks
+             getSequence: getter for sequence
+             getRecords:  getter for records
+             getBytes:    getter for bytes
+             getFirst:    key of the first client
+             getLast:     key of the last client
+             retire:      mark the run obsolete
+=============================================================================*/
+class SortedRun
+{
+   private:
+      string path;
+      long sequence;
+      int fd;
+      vector<Fence> fences;
+      ClientRecord last;
+      long records;
+      size_t bytes;
+      atomic<bool> obsolete;
+
+      /* Not copyable */
+      SortedRun(const SortedRun &);
+      SortedRun & operator=(const SortedRun &);
+
+   public:
+      SortedRun(const string &, long);
+      ~SortedRun();
+
+      bool open(void);
+      bool find(const string &, ClientRecord &) const;
+      void scan(const string &,
+                const function<bool(const ClientRecord &)> &) const;
+      bool readBlock(size_t, vector<ClientRecord> &) const;
+
+      size_t getBlocks(void) const;
+      long getSequence(void) const;
+      long getRecords(void) const;
+      size_t getBytes(void) const;
+      const ClientRecord & getFirst(void) const;
+      const ClientRecord & getLast(void) const;
+      void retire(void);
+};
+
+/*=============================================================================
+Class:       RunWriter
+
+Description: Writes clients, given in key order, as a new run. The file is
+             written beside its final name and renamed once complete.
+
+DataFields:  out:          writes the file
+             path:         final name of the run
+             payload:      encoded clients of the current block
+             blockRecords: clients in the current block
+             fences:       fence index so far
+             first:        key of the first client of the current block
+             last:         key of the last client written
+             offset:       bytes written so far
+             records:      clients written so far
+
+Functions:   RunWriter:  constructor
+             ~RunWriter: destructor
+             open:       start a run
+             add:        append a client
+             finish:     write the index and footer and put the run in place
+             getBytes:   bytes written so far
+             getRecords: clients written so far
+             closeBlock: write out the current block
+=============================================================================*/
+class RunWriter
+{
+   private:
+      StreamWriter out;
+      string path;
+      string payload;
+      uint32_t blockRecords;
+      vector<Fence> fences;
+      ClientRecord first,
+                   last;
+      size_t offset;
+      long records;
+
+      void closeBlock(void);
+
+   public:
+      RunWriter();
+      ~RunWriter();
+
+      bool open(const string &);
+      void add(const ClientRecord &);
+      bool finish(void);
+      size_t getBytes(void) const;
+      long getRecords(void) const;
+};
+
+/* Runs of each level; level 0 runs may overlap, runs of deeper levels do not
+   and are kept in key order */
+typedef vector<vector<shared_ptr<SortedRun> > > LevelList;
+
+/*=============================================================================
+Class:       LsmEngine
+
+Description: Storage engine built from a memtable and levels of sorted runs.
+
+             An insert is appended to the log of the active memtable and added
+             to it. A full memtable is frozen and a new one started; a
+             background task of the scheduler writes frozen memtables out as
+             level 0 runs. Once level 0 has too many runs they are merged with
+             level 1, and a deeper level that outgrows its limit is merged
+             into the next, so every level past 0 is a set of runs with no
+             overlapping keys. A lookup checks the memtables, every level 0 run
+             and the one run of each deeper level whose keys can hold the name,
+             and reports the client with the lowest occupant number. Name
+             queries read the same places from the start of their key range
+             on, until the names stop matching.
+
+             The manifest lists the runs of every level, the logs of the
+             memtables not yet written out, the occupancy and the next sequence
+             number, and is replaced atomically whenever they change. Opening
+             the engine replays the logs, so clients inserted before a crash
+             are kept. Only one process may have the engine open.
+
+DataFields:  lockFd:       the locked lock file; -1 when not open
+             logFd:        log of the active memtable
+             logBytes:     bytes written to it; -1 once its end is torn
+             lock:         guards the datafields below
+             active:       memtable receiving inserts
+             frozen:       full memtables waiting to be written, oldest first
+             levels:       runs of each level
+             occupants:    amount of clients
+             sequence:     next sequence number for a log or run; taken
+                           without the lock
+             epoch:        incremented by a reset; background results of an
+                           earlier epoch are discarded
+             isMaintaining: whether the background task is queued or running
+             flushes:      memtables written out
+             merges:       merges completed
+             maintenance:  the background task and removals
+
+Functions:   LsmEngine:   constructor
+             ~LsmEngine:  destructor; waits for the background task
+             open, occupancy, insert, lookup, prefix, range, reset, write,
+             describe, hasDataFile, name: as for StorageEngine
+             collect:     gather the clients of a name query
+             startLog:    start a new log for a memtable
+             reopenLog:   append to a replayed log again
+             freeze:      freeze the active memtable and start a new one
+             replay:      add the clients of a log to the active memtable
+             saveManifest: replace the manifest
+             schedule:    queue the background task unless it is queued
+             maintain:    body of the background task
+             mergeLevel:  level that should be merged into the next; -1 if
+                          none
+             flush:       write the oldest frozen memtable as a level 0 run
+             merge:       merge runs of a level into the next
+=============================================================================*/
+class LsmEngine : public StorageEngine
+{
+   private:
+      int lockFd,
+          logFd;
+      long long logBytes;
+      mutex lock;
+      shared_ptr<Memtable> active;
+      deque<shared_ptr<Memtable> > frozen;
+      LevelList levels;
+      int occupants;
+      atomic<long> sequence;
+      long epoch;
+      bool isMaintaining;
+      long flushes,
+           merges;
+      TaskGroup maintenance;
+
+      /* Not copyable */
+      LsmEngine(const LsmEngine &);
+      LsmEngine & operator=(const LsmEngine &);
+
+      void collect(const string &, const string &, bool,
+                   vector<NameEntry> &);
+      bool startLog(Memtable &);
+      bool reopenLog(long);
+      bool freeze(void);
+      long replay(long, bool &);
+      bool saveManifest(void);
+      void schedule(void);
+      void maintain(void);
+      int mergeLevel(void) const;
+      bool flush(void);
+      bool merge(int);
+
+   public:
+      LsmEngine();
+      ~LsmEngine();
+
+      bool open(void);
+      int occupancy(void);
+      bool insert(const string &, const string &, int);
+      bool lookup(const string &, ClientRecord &);
+      void prefix(const string &, vector<NameEntry> &);
+      void range(const string &, const string &, vector<NameEntry> &);
+      void reset(void);
+      string write(void);
+      string describe(void);
+      bool hasDataFile(void) const;
+      const char * name(void) const;
+};
+
+#endif
@@ -0,0 +1,819 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  NameIndex.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the classes NameDictionary
+             and NameIndex. The dictionary codes sorted names against the name
+             before them, so the shared prefixes of similar names are stored
+             once; the index keeps a dictionary of the datafile, merging the
+             names of newly appended rows into it in batches.
+#############################################################################*/
+#include<sstream>
+#include<algorithm>
+#include "NameIndex.h"
+#include "Schema.h"
+
+/* Names per block of the dictionary; each block starts with a name in full */
+static const size_t RESTART_NAMES = 16;
+
+/* Pending names are merged into the dictionary once there are more than
+   PENDING_MINIMUM of them and more than one PENDING_FRACTION of the
+   dictionary */
+static const size_t PENDING_MINIMUM = 4096;
+static const size_t PENDING_FRACTION = 16;
+
+/*-----------------------------------------------------------------------------
+Name:        NameDictionary
+
+Description: Constructor.
+
+Algorithm:   Starts with no names.
+
+Parameters:  none
+
+Output:      none
+
+Result:      NameDictionary object is allocated.
+------------------------------------------------------------------------------*/
+NameDictionary :: NameDictionary() : names(0), postings(0)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        add
+
+Description: Add a client.
+
+Algorithm:   Clients of the same name are gathered; the name is coded once the
+             next name arrives.
+
+Parameters:  name:     name of client; not before the name added last
+             occupant: occupant number of client; above any added for the name
+
+Output:      void
+
+Result:      The client will be in the dictionary once it is finished.
+------------------------------------------------------------------------------*/
+void NameDictionary :: add(const string &name, int occupant)
+{
+   if(!occupants.empty() && name != current)
+      writeEntry();
+
+   if(occupants.empty())
+      current = name;
+   occupants.push_back(occupant);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        finish
+
+Description: Write the last name; the dictionary is then complete.
+
+Algorithm:   Codes the name being added and releases the spare capacity and
+             the memory used while adding.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The dictionary can be queried.
+------------------------------------------------------------------------------*/
+void NameDictionary :: finish(void)
+{
+   if(!occupants.empty())
+      writeEntry();
+
+   data.shrink_to_fit();
+   blocks.shrink_to_fit();
+   string().swap(previous);
+   string().swap(current);
+   vector<int>().swap(occupants);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        writeEntry
+
+Description: Code the name being added.
+
+Algorithm:   At the start of a block the name is written in full and its offset
+             kept; otherwise only the part after the prefix it shares with the
+             previous name. The occupants follow as differences.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The name is part of data.
+------------------------------------------------------------------------------*/
+void NameDictionary :: writeEntry(void)
+{
+   size_t shared = 0; /* length of the prefix shared with previous */
+   int last = 0;      /* occupant written before */
+
+   if(names % RESTART_NAMES == 0)
+      blocks.push_back(data.size());
+   else
+      while(shared < previous.size() && shared < current.size() &&
+            previous[shared] == current[shared])
+         shared++;
+
+   putVarint(data, shared);
+   putVarint(data, current.size() - shared);
+   data.append(current, shared, string :: npos);
+
+   putVarint(data, occupants.size());
+   for(size_t at = 0; at < occupants.size(); at++)
+   {
+      putVarint(data, occupants[at] - last);
+      last = occupants[at];
+   }
+
+   names++;
+   postings += occupants.size();
+   previous.swap(current);
+   occupants.clear();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        decodeEntry
+
+Description: Decode the next name.
+
+Algorithm:   Keeps the shared prefix of the name decoded before, appends the
+             rest and adds up the occupant differences.
+
+Parameters:  at:        position of the name; moved past it
+             end:       end of the data
+             name:      the previous name on entry, this one on return
+             occupants: the occupants of the name
+
+Output:      true when a whole name was decoded
+
+Result:      name and occupants hold the name decoded.
+------------------------------------------------------------------------------*/
+bool NameDictionary :: decodeEntry(const char *&at, const char *end,
+                                   string &name, vector<int> &occupants) const
+{
+   int64_t shared,   /* length kept from the previous name */
+           suffix,   /* length of the rest */
+           count,    /* amount of occupants */
+           value;    /* one occupant difference */
+   int last = 0;     /* occupant decoded before */
+
+   if(!getVarint(at, end, shared) || shared < 0 ||
+      shared > static_cast<int64_t>(name.size()) ||
+      !getVarint(at, end, suffix) || suffix < 0 || suffix > end - at)
+      return false;
+
+   name.resize(shared);
+   name.append(at, suffix);
+   at += suffix;
+
+   if(!getVarint(at, end, count) || count < 0)
+      return false;
+
+   occupants.clear();
+   for(int64_t posting = 0; posting < count; posting++)
+   {
+      if(!getVarint(at, end, value))
+         return false;
+      last += value;
+      occupants.push_back(last);
+   }
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        seekBlock
+
+Description: Block a name falls in.
+
+Algorithm:   Binary search for the last block whose first name is not after the
+             name, reading only the first name of each block probed.
+
+Parameters:  name: the name
+
+Output:      block: index of the block; 0 when the name is before every block
+
+Result:      Block is returned.
+------------------------------------------------------------------------------*/
+size_t NameDictionary :: seekBlock(const string &name) const
+{
+   const char *end = data.data() + data.size(); /* end of the data */
+   size_t low = 0,                              /* last block known not to
+                                                   start after name */
+          high = blocks.size();                 /* first block known to */
+
+   while(high - low > 1)
+   {
+      size_t middle = low + (high - low) / 2;
+      const char *at = data.data() + blocks[middle];
+      int64_t shared,
+              suffix;
+
+      if(!getVarint(at, end, shared) || !getVarint(at, end, suffix))
+         break;
+
+      if(name.compare(0, string :: npos, at, suffix) >= 0)
+         low = middle;
+      else
+         high = middle;
+   }
+
+   /* Return value */
+   return low;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        find
+
+Description: Occupants of a name.
+
+Algorithm:   Decodes the names of the block the name falls in until it is
+             found or passed.
+
+Parameters:  name:      the name
+             occupants: occupant numbers of the clients with the name, lowest
+                        first
+
+Output:      isFound: whether the name is in the dictionary
+
+Result:      occupants holds the name's clients.
+------------------------------------------------------------------------------*/
+bool NameDictionary :: find(const string &name, vector<int> &occupants) const
+{
+   if(blocks.empty())
+      return false;
+
+   size_t block = seekBlock(name);          /* block holding name */
+   const char *at = data.data() + blocks[block];
+   const char *end = block + 1 < blocks.size() ?
+                     data.data() + blocks[block + 1] :
+                     data.data() + data.size();
+   string decoded;                          /* name decoded */
+
+   while(at < end && decodeEntry(at, end, decoded, occupants))
+   {
+      int order = decoded.compare(name);
+
+      if(order == 0)
+         return true;
+      if(order > 0)
+         return false;
+   }
+
+   /* Return value */
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        scan
+
+Description: Visit names in order from a name on.
+
+Algorithm:   Starts decoding at the block the name falls in, skips the names
+             before it and passes every later name to visit until visit
+             returns false or the names run out.
+
+Parameters:  from:  first name visited, if present; "" visits every name
+             visit: called with each name and its occupants; returns whether
+                    to go on
+
+Output:      void
+
+Result:      visit has seen the names from from on.
+------------------------------------------------------------------------------*/
+void NameDictionary :: scan(const string &from,
+   const function<bool(const string &, const vector<int> &)> &visit) const
+{
+   if(blocks.empty())
+      return;
+
+   const char *at = data.data() + blocks[seekBlock(from)];
+   const char *end = data.data() + data.size();
+   string decoded;                 /* name decoded */
+   vector<int> occupants;          /* its occupants */
+
+   while(at < end && decodeEntry(at, end, decoded, occupants))
+   {
+      if(decoded < from)
+         continue;
+      if(!visit(decoded, occupants))
+         return;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getNames
+
+Description: Getter for names.
+
+Algorithm:   Returns names.
+
+Parameters:  none
+
+Output:      names: amount of names
+
+Result:      Names are returned.
+------------------------------------------------------------------------------*/
+size_t NameDictionary :: getNames(void) const
+{
+   return names;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getPostings
+
+Description: Getter for postings.
+
+Algorithm:   Returns postings.
+
+Parameters:  none
+
+Output:      postings: amount of occupant numbers
+
+Result:      Postings are returned.
+------------------------------------------------------------------------------*/
+size_t NameDictionary :: getPostings(void) const
+{
+   return postings;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getBytes
+
+Description: Memory held.
+
+Algorithm:   Adds the capacity of the coded names and block offsets to the size
+             of the object.
+
+Parameters:  none
+
+Output:      bytes: memory held
+
+Result:      Bytes are returned.
+------------------------------------------------------------------------------*/
+size_t NameDictionary :: getBytes(void) const
+{
+   return sizeof(*this) + data.capacity() +
+          blocks.capacity() * sizeof(size_t);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        NameIndex
+
+Description: Constructor.
+
+Algorithm:   Starts with an empty dictionary and no generation indexed.
+
+Parameters:  none
+
+Output:      none
+
+Result:      NameIndex object is allocated.
+------------------------------------------------------------------------------*/
+NameIndex :: NameIndex() : pendingPostings(0), generation(-1), indexed(0),
+                           rowsStart(-1), clients(0), isFixed(true),
+                           rebuilds(0)
+{
+   shared_ptr<NameDictionary> empty = make_shared<NameDictionary>();
+
+   empty->finish();
+   dictionary = empty;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~NameIndex
+
+Description: Destructor.
+
+Algorithm:   Nothing to release beyond the datafields.
+
+Parameters:  none
+
+Output:      none
+
+Result:      NameIndex object is deallocated.
+------------------------------------------------------------------------------*/
+NameIndex :: ~NameIndex()
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        sync
+
+Description: Read the rows committed since the last use.
+
+Algorithm:   A snapshot of a newer generation starts the index over; one of an
+             older generation, or with an unknown amount of committed bytes,
+             cannot be answered. Otherwise the committed rows past the bytes
+             already read are streamed and parsed in place. Each row is
+             checked to have the fixed width and to sit where its occupant
+             number puts it, which a line that is not a row would break. The
+             names read are added to the pending table, or merged with it into
+             the dictionary once it would grow too large. Must be called with
+             the lock held.
+
+Parameters:  view: the snapshot to answer for
+
+Output:      true when the index covers the snapshot's generation
+
+Result:      Every row of the snapshot is indexed.
+------------------------------------------------------------------------------*/
+bool NameIndex :: sync(const ReadView &view)
+{
+   const Manifest &manifest = view.getManifest(); /* the pinned record */
+   const long long STRIDE = ClientSchema :: rowWidth + 1; /* fixed row */
+   vector<NameEntry> fresh;                       /* clients read */
+   StreamReader reader;                           /* reads the new rows */
+   string_view rows;                              /* rows read */
+   off_t at;                                      /* offset of rows */
+
+   if(manifest.bytes < 0 || manifest.generation < generation)
+      return false;
+
+   /* A new generation starts over */
+   if(manifest.generation > generation)
+   {
+      shared_ptr<NameDictionary> empty = make_shared<NameDictionary>();
+
+      empty->finish();
+      dictionary = empty;
+      pending.clear();
+      pendingPostings = 0;
+      generation = manifest.generation;
+      indexed = 0;
+      rowsStart = -1;
+      clients = 0;
+      isFixed = true;
+   }
+
+   if(manifest.bytes <= indexed)
+      return true;
+
+   /* Parse the whole rows committed since, in place, while the next block
+      is read */
+   if(!view.stream(reader, indexed))
+      return true;
+   while(reader.nextRows(rows, at) && rows.back() == '\n')
+   {
+      ClientRows clientRows(rows); /* clients of the rows */
+
+      for(ClientRows :: iterator row = clientRows.begin();
+          row != clientRows.end(); ++row)
+      {
+         long long offset = at + (row.getRow().data() - rows.data());
+
+         if(rowsStart < 0)
+            rowsStart = offset;
+         isFixed = isFixed &&
+                   row.getRow().size() == ClientSchema :: rowWidth &&
+                   row->occupant == clients + 1 &&
+                   offset == rowsStart + clients * STRIDE;
+         clients++;
+
+         fresh.push_back(NameEntry());
+         fresh.back().name.assign(row->name.data(), row->name.size());
+         fresh.back().occupant = row->occupant;
+      }
+      indexed = at + rows.size();
+   }
+   reader.close();
+
+   /* Merge in a batch, or keep the names pending */
+   if(pendingPostings + fresh.size() >
+      max(PENDING_MINIMUM, dictionary->getPostings() / PENDING_FRACTION))
+      merge(fresh);
+   else
+      for(size_t entry = 0; entry < fresh.size(); entry++)
+      {
+         pending[fresh[entry].name].push_back(fresh[entry].occupant);
+         pendingPostings++;
+      }
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        merge
+
+Description: Merge pending names into a new dictionary.
+
+Algorithm:   The clients just read are sorted by name, keeping their order
+             within a name. The dictionary, the pending table and those
+             clients are then walked together in name order into a new
+             dictionary. Clients of a name come from the dictionary first,
+             then the pending table, then the new rows, which is also the order
+             they were appended in. Must be called with the lock held.
+
+Parameters:  fresh: clients read and not yet pending
+
+Output:      void
+
+Result:      The dictionary holds every client indexed; nothing is pending.
+------------------------------------------------------------------------------*/
+void NameIndex :: merge(vector<NameEntry> &fresh)
+{
+   shared_ptr<NameDictionary> next = make_shared<NameDictionary>();
+   map<string, vector<int> > :: const_iterator waiting = pending.begin();
+   size_t entry = 0; /* next of fresh */
+
+   stable_sort(fresh.begin(), fresh.end(),
+               [](const NameEntry &left, const NameEntry &right)
+               {
+                  return left.name < right.name;
+               });
+
+   /* Add pending and fresh clients named before limit, or all of them */
+   auto addBefore = [&](const string *limit)
+   {
+      for(;;)
+      {
+         const string *name = NULL; /* lowest name left */
+
+         if(waiting != pending.end())
+            name = &waiting->first;
+         if(entry < fresh.size() && (name == NULL || fresh[entry].name < *name))
+            name = &fresh[entry].name;
+         if(name == NULL || (limit != NULL && !(*name < *limit)))
+            return;
+
+         string current = *name;
+         if(waiting != pending.end() && waiting->first == current)
+         {
+            for(size_t at = 0; at < waiting->second.size(); at++)
+               next->add(current, waiting->second[at]);
+            ++waiting;
+         }
+         while(entry < fresh.size() && fresh[entry].name == current)
+            next->add(current, fresh[entry++].occupant);
+      }
+   };
+
+   dictionary->scan("", [&](const string &name, const vector<int> &occupants)
+      {
+         addBefore(&name);
+
+         for(size_t at = 0; at < occupants.size(); at++)
+            next->add(name, occupants[at]);
+         if(waiting != pending.end() && waiting->first == name)
+         {
+            for(size_t at = 0; at < waiting->second.size(); at++)
+               next->add(name, waiting->second[at]);
+            ++waiting;
+         }
+         while(entry < fresh.size() && fresh[entry].name == name)
+            next->add(name, fresh[entry++].occupant);
+
+         return true;
+      });
+   addBefore(NULL);
+
+   next->finish();
+   dictionary = next;
+   pending.clear();
+   pendingPostings = 0;
+   rebuilds++;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        collect
+
+Description: Gather the clients of a query.
+
+Algorithm:   Scans the dictionary and the pending table from the first name
+             while names match, and sorts what was found by name and occupant
+             number. Must be called with the lock held.
+
+Parameters:  first:    first name, or the prefix
+             last:     last name of a range
+             isPrefix: whether names must start with first instead of lying
+                       between first and last
+             most:     highest occupant number of the snapshot
+             found:    the clients gathered
+
+Output:      void
+
+Result:      found holds the clients of the query.
+------------------------------------------------------------------------------*/
+void NameIndex :: collect(const string &first, const string &last,
+                          bool isPrefix, int most,
+                          vector<NameEntry> &found) const
+{
+   /* Whether a name is still part of the query */
+   auto matches = [&](const string &name)
+   {
+      return isPrefix ? name.compare(0, first.size(), first) == 0 :
+                        name <= last;
+   };
+   /* Add the clients of a name */
+   auto addAll = [&](const string &name, const vector<int> &occupants)
+   {
+      for(size_t at = 0; at < occupants.size(); at++)
+         if(occupants[at] <= most)
+         {
+            found.push_back(NameEntry());
+            found.back().name = name;
+            found.back().occupant = occupants[at];
+         }
+   };
+
+   found.clear();
+   dictionary->scan(first, [&](const string &name, const vector<int> &occupants)
+      {
+         if(!matches(name))
+            return false;
+         addAll(name, occupants);
+         return true;
+      });
+
+   for(map<string, vector<int> > :: const_iterator waiting =
+          pending.lower_bound(first);
+       waiting != pending.end() && matches(waiting->first); ++waiting)
+      addAll(waiting->first, waiting->second);
+
+   sort(found.begin(), found.end(),
+        [](const NameEntry &left, const NameEntry &right)
+        {
+           int order = left.name.compare(right.name);
+
+           return order != 0 ? order < 0 : left.occupant < right.occupant;
+        });
+}
+
+/*-----------------------------------------------------------------------------
+Name:        find
+
+Description: First client of a name as of a snapshot.
+
+Algorithm:   Brings the index up to the snapshot and takes the lowest occupant
+             of the name, from the dictionary when it is there since pending
+             clients are newer. A client appended after the snapshot does not
+             count. When the rows are in place, the offset of the client's row
+             is worked out from its occupant number.
+
+Parameters:  view:     the snapshot
+             name:     name of client to search
+             isFound:  whether a client with the name exists
+             occupant: occupant number of the first client with the name
+             offset:   where its row starts; -1 when unknown
+
+Output:      true when the index could answer for the snapshot
+
+Result:      isFound, occupant and offset are set.
+------------------------------------------------------------------------------*/
+bool NameIndex :: find(const ReadView &view, const string &name,
+                       bool &isFound, int &occupant, long long &offset)
+{
+   lock_guard<mutex> guard(lock);
+   vector<int> occupants; /* clients with the name */
+   int first = 0;         /* lowest occupant; 0 if none */
+
+   if(!sync(view))
+      return false;
+
+   if(dictionary->find(name, occupants))
+      first = occupants[0];
+   else
+   {
+      map<string, vector<int> > :: const_iterator waiting =
+         pending.find(name);
+
+      if(waiting != pending.end())
+         first = waiting->second[0];
+   }
+
+   isFound = first > 0 && first <= view.getManifest().occupancy;
+   occupant = first;
+   offset = isFound && isFixed ?
+            rowsStart + (first - 1) *
+                        static_cast<long long>(ClientSchema :: rowWidth + 1) :
+            -1;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        prefix
+
+Description: Clients whose names start with a text.
+
+Algorithm:   Brings the index up to the snapshot and collects the names that
+             start with the text.
+
+Parameters:  view:  the snapshot
+             text:  the prefix; "" matches every name
+             found: the clients, by name and then occupant number
+
+Output:      true when the index could answer for the snapshot
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+bool NameIndex :: prefix(const ReadView &view, const string &text,
+                         vector<NameEntry> &found)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(!sync(view))
+      return false;
+   collect(text, string(), true, view.getManifest().occupancy, found);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        range
+
+Description: Clients whose names lie between two names.
+
+Algorithm:   Brings the index up to the snapshot and collects the names from
+             first to last, both included.
+
+Parameters:  view:  the snapshot
+             first: lowest name
+             last:  highest name
+             found: the clients, by name and then occupant number
+
+Output:      true when the index could answer for the snapshot
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+bool NameIndex :: range(const ReadView &view, const string &first,
+                        const string &last, vector<NameEntry> &found)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(!sync(view))
+      return false;
+   collect(first, last, false, view.getManifest().occupancy, found);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        describe
+
+Description: Metrics for the (s)Stats command.
+
+Algorithm:   Reports the names and clients indexed and the memory held by the
+             dictionary and by the pending table, counting a node, the name
+             and the occupants for each pending name.
+
+Parameters:  none
+
+Output:      text: one line of metrics
+
+Result:      Text is returned.
+------------------------------------------------------------------------------*/
+string NameIndex :: describe(void) const
+{
+   lock_guard<mutex> guard(lock);
+   ostringstream text;    /* the metrics */
+   size_t bytes = dictionary->getBytes(); /* memory held */
+
+   for(map<string, vector<int> > :: const_iterator waiting = pending.begin();
+       waiting != pending.end(); ++waiting)
+      bytes += sizeof(*waiting) + 4 * sizeof(void *) +
+               waiting->first.capacity() +
+               waiting->second.capacity() * sizeof(int);
+
+   text << "Name index: " << dictionary->getNames() << " name(s) and "
+        << pending.size() << " pending for " << clients << " client(s), "
+        << bytes << " byte(s)";
+   if(clients > 0)
+      text << " (" << static_cast<double>(bytes) / clients << " per client)";
+   text << ", " << rebuilds << " rebuild(s).";
+
+   /* Return value */
+   return text.str();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        nameIndex
+
+Description: Index shared by the whole program.
+
+Algorithm:   Constructs the index the first time it is asked for.
+
+Parameters:  none
+
+Output:      index: the shared index
+
+Result:      The shared index is returned.
+------------------------------------------------------------------------------*/
+NameIndex & nameIndex(void)
+{
+   static NameIndex shared;
+
+   return shared;
+}
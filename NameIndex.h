@@ -0,0 +1,187 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  NameIndex.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definitions of the name
+             dictionary, a compact immutable map from client names to occupant
+             numbers, and of the class NameIndex, which keeps a dictionary of
+             the datafile up to date as clients are appended.
+#############################################################################*/
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include<string>
+#include<vector>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<functional>
+#include<stdint.h>
+#include "Version.h"
+
+using namespace std;
+
+/*=============================================================================
+Struct:      NameEntry
+
+Description: One client found by a name query.
+
+DataFields:  name:     name of client
+             occupant: occupant number of client
+=============================================================================*/
+struct NameEntry
+{
+   string name;
+   int occupant;
+};
+
+/*=============================================================================
+Class:       NameDictionary
+
+Description: Sorted names with the occupant numbers of the clients holding
+             each, front coded in one buffer.
+
+             Names are added in order and written one after the other as the
+             length of the prefix shared with the previous name, the rest of
+             the name, the amount of occupants and the occupants, the first in
+             full and the others as the difference from the one before, all as
+             variable length integers. Every RESTART_NAMES names a block starts
+             with a name written in full, and only the offsets of the blocks
+             are kept, so a name costs a few bytes instead of a string and a
+             hash table node. A query finds its block by binary search over the
+             blocks' first names and decodes forward from there.
+
+DataFields:  data:      the coded names
+             blocks:    offset of every block in data
+             names:     amount of names
+             postings:  amount of occupant numbers
+             previous:  last name written; only while adding
+             current:   name being added; only while adding
+             occupants: occupants of current; only while adding
+
+Functions:   NameDictionary: constructor
+             add:         add a client; names must come in order
+             finish:      write the last name; the dictionary is then complete
+             find:        occupants of a name
+             scan:        visit names in order from a name on
+             getNames:    getter for names
+             getPostings: getter for postings
+             getBytes:    memory held
+             writeEntry:  code the name being added
+             decodeEntry: decode the next name
+             seekBlock:   block a name falls in
+=============================================================================*/
+class NameDictionary
+{
+   private:
+      string data;
+      vector<size_t> blocks;
+      size_t names,
+             postings;
+      string previous,
+             current;
+      vector<int> occupants;
+
+      void writeEntry(void);
+      bool decodeEntry(const char *&, const char *, string &,
+                       vector<int> &) const;
+      size_t seekBlock(const string &) const;
+
+   public:
+      NameDictionary();
+
+      void add(const string &, int);
+      void finish(void);
+
+      bool find(const string &, vector<int> &) const;
+      void scan(const string &,
+                const function<bool(const string &, const vector<int> &)> &)
+         const;
+
+      size_t getNames(void) const;
+      size_t getPostings(void) const;
+      size_t getBytes(void) const;
+};
+
+/*=============================================================================
+Class:       NameIndex
+
+Description: Name dictionary of the datafile, brought up to date from the rows
+             appended since it was last used.
+
+             The index remembers the generation and how many bytes of the
+             datafile it has read. Before answering, it reads the rows
+             committed since then, whoever appended them, and adds their names
+             to a small sorted table of pending names. Once that table holds
+             more than a sixteenth of the dictionary, it is merged with the
+             dictionary into a new one, so each client is rewritten a bounded
+             number of times however many are appended. A new generation, after
+             a reset or load, starts the index over.
+
+             While every row has the fixed width and follows the one before,
+             the place of a client's row follows from its occupant number, so
+             a lookup reads a single row.
+
+DataFields:  dictionary: names merged so far
+             pending:    names read since the last merge
+             pendingPostings: occupant numbers in pending
+             generation: generation indexed
+             indexed:    bytes of the datafile read
+             rowsStart:  offset of the first row; -1 before one is read
+             clients:    rows read
+             isFixed:    every row read has the fixed width and is in place
+             rebuilds:   merges into a new dictionary
+             lock:       guards every datafield
+
+Functions:   NameIndex:   constructor
+             ~NameIndex:  destructor
+             find:        first client of a name as of a snapshot
+             prefix:      clients whose names start with a text
+             range:       clients whose names lie between two names
+             describe:    metrics for the (s)Stats command
+             sync:        read the rows committed since the last use
+             merge:       merge pending names into a new dictionary
+             collect:     gather the clients of a query
+=============================================================================*/
+class NameIndex
+{
+   private:
+      shared_ptr<const NameDictionary> dictionary;
+      map<string, vector<int> > pending;
+      size_t pendingPostings;
+      long generation;
+      long long indexed,
+                rowsStart;
+      int clients;
+      bool isFixed;
+      long rebuilds;
+      mutable mutex lock;
+
+      /* Not copyable */
+      NameIndex(const NameIndex &);
+      NameIndex & operator=(const NameIndex &);
+
+      bool sync(const ReadView &);
+      void merge(vector<NameEntry> &);
+      void collect(const string &, const string &, bool, int,
+                   vector<NameEntry> &) const;
+
+   public:
+      NameIndex();
+      ~NameIndex();
+
+      bool find(const ReadView &, const string &, bool &, int &, long long &);
+      bool prefix(const ReadView &, const string &, vector<NameEntry> &);
+      bool range(const ReadView &, const string &, const string &,
+                 vector<NameEntry> &);
+      string describe(void) const;
+};
+
+/* Index shared by the whole program */
+NameIndex & nameIndex(void);
+
+#endif
@@ -0,0 +1,515 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Scheduler.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the task scheduler. Tasks are kept in a queue
+             per worker and per priority class; a worker with nothing of its
+             own steals from the others, and large ranges of work are split in
+             halves so idle workers always find a sizeable piece to take.
+#############################################################################*/
+#include "Scheduler.h"
+
+/* Index of the worker running on this thread; -1 for other threads */
+static thread_local int currentWorker = -1;
+
+/*-----------------------------------------------------------------------------
+Name:        TaskGroup
+
+Description: Constructor.
+
+Algorithm:   Starts with no pending tasks.
+
+Parameters:  cls: priority class of the group's tasks
+
+Output:      none
+
+Result:      TaskGroup object is allocated.
+------------------------------------------------------------------------------*/
+TaskGroup :: TaskGroup(Priority cls) : priority(cls), pending(0)
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getPriority
+
+Description: Getter for priority.
+
+Algorithm:   Returns priority.
+
+Parameters:  none
+
+Output:      priority: class of the group's tasks
+
+Result:      Priority is returned.
+------------------------------------------------------------------------------*/
+Priority TaskGroup :: getPriority(void) const
+{
+   return priority;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        isDone
+
+Description: Whether every task of the group has finished.
+
+Algorithm:   Compares pending with zero.
+
+Parameters:  none
+
+Output:      true when nothing is pending
+
+Result:      Status is returned.
+------------------------------------------------------------------------------*/
+bool TaskGroup :: isDone(void) const
+{
+   return pending == 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        Scheduler
+
+Description: Constructor.
+
+Algorithm:   Makes a queue for each worker, allows half of them to run
+             background tasks at once and starts them.
+
+Parameters:  count: amount of workers; at least one is started
+
+Output:      none
+
+Result:      Workers are waiting for tasks.
+------------------------------------------------------------------------------*/
+Scheduler :: Scheduler(unsigned count) :
+             queues(count > 0 ? count : 1), background(0), next(0),
+             executed(0), steals(0), stopping(false)
+{
+   for(int cls = FOREGROUND; cls < PRIORITY_CLASSES; cls++)
+      queued[cls] = 0;
+
+   backgroundLimit = queues.size() / 2;
+   if(backgroundLimit < 1)
+      backgroundLimit = 1;
+
+   for(size_t worker = 0; worker < queues.size(); worker++)
+      workers.push_back(thread(&Scheduler :: work, this, worker));
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~Scheduler
+
+Description: Destructor.
+
+Algorithm:   Sets stopping, wakes every worker and joins them. Workers finish
+             every queued task before they exit.
+
+Parameters:  none
+
+Output:      none
+
+Result:      All workers have exited.
+------------------------------------------------------------------------------*/
+Scheduler :: ~Scheduler()
+{
+   {
+      lock_guard<mutex> guard(lock);
+      stopping = true;
+   }
+   idle.notify_all();
+
+   for(size_t worker = 0; worker < workers.size(); worker++)
+      workers[worker].join();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        submit
+
+Description: Queue a task in a group.
+
+Algorithm:   A worker queues the task on its own queue, where it will most
+             likely run it next; any other thread spreads its tasks over the
+             workers in turn. A sleeping worker and anyone waiting on the group
+             are woken.
+
+Parameters:  group: group the task joins
+             run:   the work
+
+Output:      void
+
+Result:      The task will be run by a worker or a waiter on the group.
+------------------------------------------------------------------------------*/
+void Scheduler :: submit(TaskGroup &group, function<void()> run)
+{
+   Task task;  /* the queued task */
+   int target; /* worker whose queue receives it */
+
+   task.run = run;
+   task.group = &group;
+   group.pending++;
+
+   target = currentWorker >= 0 ? currentWorker : next++ % queues.size();
+   {
+      lock_guard<mutex> guard(queues[target].lock);
+      queues[target].tasks[group.priority].push_back(task);
+   }
+   queued[group.priority]++;
+
+   {
+      lock_guard<mutex> guard(lock);
+   }
+   idle.notify_one();
+
+   {
+      lock_guard<mutex> guard(group.lock);
+   }
+   group.finished.notify_all();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        take
+
+Description: Find a task, stealing if needed.
+
+Algorithm:   Priority classes are tried in order up to most. In each, the
+             thread's own queue is tried at the back and then every other queue
+             at the front, starting after its own. When gated, a background
+             task is only taken while fewer than backgroundLimit run; the limit
+             is checked without holding a lock, so it can be exceeded briefly.
+
+Parameters:  self:  worker index of the calling thread; -1 if not a worker
+             most:  lowest priority class that may be taken
+             gated: whether the background limit applies
+             task:  the task found
+
+Output:      true when a task was found
+
+Result:      task is removed from its queue.
+------------------------------------------------------------------------------*/
+bool Scheduler :: take(int self, Priority most, bool gated, Task &task)
+{
+   const size_t COUNT = queues.size(); /* amount of queues */
+
+   for(int cls = FOREGROUND; cls <= most; cls++)
+   {
+      if(queued[cls] == 0)
+         continue;
+      if(cls == BACKGROUND && gated && background >= backgroundLimit)
+         break;
+
+      if(self >= 0)
+      {
+         WorkerQueue &own = queues[self];
+         lock_guard<mutex> guard(own.lock);
+
+         if(!own.tasks[cls].empty())
+         {
+            task = own.tasks[cls].back();
+            own.tasks[cls].pop_back();
+            queued[cls]--;
+            if(cls == BACKGROUND)
+               background++;
+            return true;
+         }
+      }
+
+      for(size_t at = 1; at <= COUNT; at++)
+      {
+         size_t victim = self < 0 ? at - 1 : (self + at) % COUNT;
+         if(static_cast<int>(victim) == self)
+            continue;
+
+         WorkerQueue &other = queues[victim];
+         lock_guard<mutex> guard(other.lock);
+
+         if(!other.tasks[cls].empty())
+         {
+            task = other.tasks[cls].front();
+            other.tasks[cls].pop_front();
+            queued[cls]--;
+            if(cls == BACKGROUND)
+               background++;
+            if(self >= 0)
+               steals++;
+            return true;
+         }
+      }
+   }
+
+   /* Return value */
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        execute
+
+Description: Run a task and account for it.
+
+Algorithm:   Runs the work, gives back a background slot, waking a worker that
+             may have been held back by the limit, and counts the task off its
+             group. The count drops under the group's lock so a waiter that
+             sees the group done cannot destroy it while it is still being
+             signalled.
+
+Parameters:  task: the task to run
+
+Output:      void
+
+Result:      The task has run.
+------------------------------------------------------------------------------*/
+void Scheduler :: execute(Task &task)
+{
+   TaskGroup *group = task.group; /* group to count the task off */
+
+   task.run();
+   executed++;
+
+   if(group->priority == BACKGROUND)
+   {
+      background--;
+      {
+         lock_guard<mutex> guard(lock);
+      }
+      idle.notify_one();
+   }
+
+   lock_guard<mutex> guard(group->lock);
+   if(--group->pending == 0)
+      group->finished.notify_all();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        work
+
+Description: Loop run by every worker.
+
+Algorithm:   Takes and runs tasks of any class until none can be found, then
+             sleeps until one it may take is queued. Queuing a task, freeing a
+             background slot and stopping all pass through the lock after the
+             counts change and before signalling idle, so the sleep cannot
+             miss them. Exits once
+             stopping is set and every queue is empty.
+
+Parameters:  self: index of the worker
+
+Output:      void
+
+Result:      Tasks are run until the scheduler stops.
+------------------------------------------------------------------------------*/
+void Scheduler :: work(int self)
+{
+   currentWorker = self;
+
+   for(;;)
+   {
+      Task task; /* task found */
+
+      if(take(self, BACKGROUND, true, task))
+      {
+         execute(task);
+         continue;
+      }
+
+      unique_lock<mutex> guard(lock);
+      if(stopping && queued[FOREGROUND] == 0 && queued[BACKGROUND] == 0)
+         return;
+      idle.wait(guard, [this]()
+                {
+                   return stopping || queued[FOREGROUND] > 0 ||
+                          (queued[BACKGROUND] > 0 &&
+                           background < backgroundLimit);
+                });
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        wait
+
+Description: Run tasks until every task of a group has finished.
+
+Algorithm:   Rather than sleep, the waiting thread takes and runs tasks of the
+             group's class or more urgent ones, so a caller outside the pool
+             adds its own thread to the work and a worker waiting on subtasks
+             cannot leave them unrun. It only sleeps when nothing can be taken,
+             until a task of the group finishes or is submitted. Both pass
+             through the group's lock after pending or queued changes and
+             before signalling, so the sleep cannot miss them.
+
+Parameters:  group: the group to wait on
+
+Output:      void
+
+Result:      Every task of the group has finished.
+------------------------------------------------------------------------------*/
+void Scheduler :: wait(TaskGroup &group)
+{
+   while(group.pending > 0)
+   {
+      Task task; /* task found */
+
+      if(take(currentWorker, group.priority, false, task))
+      {
+         execute(task);
+         continue;
+      }
+
+      unique_lock<mutex> guard(group.lock);
+      group.finished.wait(guard, [this, &group]()
+                          {
+                             return group.pending == 0 ||
+                                    queued[FOREGROUND] > 0 ||
+                                    (group.priority == BACKGROUND &&
+                                     queued[BACKGROUND] > 0);
+                          });
+   }
+
+   /* The last task to finish may still be signalling */
+   lock_guard<mutex> guard(group.lock);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        split
+
+Description: Body of a parallelFor subtask.
+
+Algorithm:   While the range is larger than grain, its upper half is submitted
+             as a subtask and the lower half kept. The remaining piece is given
+             to the function.
+
+Parameters:  group: group of the parallelFor
+             begin: start of the range
+             end:   end of the range
+             grain: largest range run without splitting
+             body:  function run over each piece
+
+Output:      void
+
+Result:      The range is covered by body and queued subtasks.
+------------------------------------------------------------------------------*/
+void Scheduler :: split(TaskGroup &group, size_t begin, size_t end,
+                        size_t grain,
+                        const function<void(size_t, size_t)> &body)
+{
+   while(end - begin > grain)
+   {
+      size_t middle = begin + (end - begin) / 2;
+
+      submit(group, [this, &group, middle, end, grain, &body]()
+             {
+                split(group, middle, end, grain, body);
+             });
+      end = middle;
+   }
+
+   if(begin < end)
+      body(begin, end);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        parallelFor
+
+Description: Run a function over a range split into subtasks.
+
+Algorithm:   The caller splits the range and runs the first piece itself, then
+             waits on the group, helping with the rest.
+
+Parameters:  cls:   priority class of the subtasks
+             begin: start of the range
+             end:   end of the range
+             grain: largest range run without splitting; 0 is taken as 1
+             body:  function run over each piece as body(first, last + 1)
+
+Output:      void
+
+Result:      body has run over the whole range.
+------------------------------------------------------------------------------*/
+void Scheduler :: parallelFor(Priority cls, size_t begin, size_t end,
+                              size_t grain,
+                              const function<void(size_t, size_t)> &body)
+{
+   TaskGroup group(cls); /* the subtasks */
+
+   if(grain == 0)
+      grain = 1;
+
+   if(begin < end)
+      split(group, begin, end, grain, body);
+   wait(group);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getWorkers
+
+Description: Amount of workers.
+
+Algorithm:   Returns the size of workers.
+
+Parameters:  none
+
+Output:      workers: amount of workers
+
+Result:      Amount is returned.
+------------------------------------------------------------------------------*/
+unsigned Scheduler :: getWorkers(void) const
+{
+   return workers.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getExecuted
+
+Description: Getter for executed.
+
+Algorithm:   Returns executed.
+
+Parameters:  none
+
+Output:      executed: tasks run
+
+Result:      Executed is returned.
+------------------------------------------------------------------------------*/
+long Scheduler :: getExecuted(void) const
+{
+   return executed;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getSteals
+
+Description: Getter for steals.
+
+Algorithm:   Returns steals.
+
+Parameters:  none
+
+Output:      steals: tasks taken from another worker's queue
+
+Result:      Steals are returned.
+------------------------------------------------------------------------------*/
+long Scheduler :: getSteals(void) const
+{
+   return steals;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        scheduler
+
+Description: Scheduler shared by the whole program.
+
+Algorithm:   Constructs the scheduler with a worker per hardware thread the
+             first time it is asked for.
+
+Parameters:  none
+
+Output:      scheduler: the shared scheduler
+
+Result:      The shared scheduler is returned.
+------------------------------------------------------------------------------*/
+Scheduler & scheduler(void)
+{
+   static Scheduler shared(thread :: hardware_concurrency());
+
+   return shared;
+}
@@ -0,0 +1,184 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Scheduler.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definitions of the task
+             scheduler the database runs its parallel work on. Each worker
+             keeps its own queues and takes work from the others when its own
+             run dry, and foreground work such as lookups always goes before
+             background maintenance.
+#############################################################################*/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include<deque>
+#include<vector>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<functional>
+#include<condition_variable>
+
+using namespace std;
+
+/* Priority classes; lower values are always taken first */
+enum Priority
+{
+   FOREGROUND,
+   BACKGROUND,
+   PRIORITY_CLASSES
+};
+
+/*=============================================================================
+Class:       TaskGroup
+
+Description: A set of tasks of one priority class that a caller waits on
+             together. Subtasks submitted from a task of the group join it.
+
+DataFields:  priority: class of every task in the group
+             pending:  tasks submitted and not yet finished
+             lock:     guards waiting on finished
+             finished: signalled when pending drops to zero
+
+Functions:   TaskGroup:   constructor
+             getPriority: getter for priority
+             isDone:      whether every task has finished
+=============================================================================*/
+class TaskGroup
+{
+   friend class Scheduler;
+
+   private:
+      Priority priority;
+      atomic<long> pending;
+      mutex lock;
+      condition_variable finished;
+
+      /* Not copyable */
+      TaskGroup(const TaskGroup &);
+      TaskGroup & operator=(const TaskGroup &);
+
+   public:
+      TaskGroup(Priority);
+
+      Priority getPriority(void) const;
+      bool isDone(void) const;
+};
+
+/*=============================================================================
+Struct:      Task
+
+Description: A unit of work waiting in a queue.
+
+DataFields:  run:   the work
+             group: group the work belongs to
+=============================================================================*/
+struct Task
+{
+   function<void()> run;
+   TaskGroup *group;
+};
+
+/*=============================================================================
+Struct:      WorkerQueue
+
+Description: The queues of one worker, one per priority class. The owner
+             pushes and takes at the back, so it works on what it split most
+             recently; other workers steal from the front, where the oldest and
+             so largest pieces of work are.
+
+DataFields:  lock:  guards tasks
+             tasks: waiting tasks of each priority class
+=============================================================================*/
+struct WorkerQueue
+{
+   mutex lock;
+   deque<Task> tasks[PRIORITY_CLASSES];
+};
+
+/*=============================================================================
+Class:       Scheduler
+
+Description: Work stealing pool of threads.
+
+             A foreground task is always taken before any background task,
+             from the worker's own queue or any other. At most half the
+             workers, and at least one, run background tasks at a time, so
+             maintenance cannot occupy every worker when a lookup arrives. A
+             thread waiting on a group runs tasks while it waits rather than
+             sleeping; a foreground waiter only runs foreground tasks, and a
+             background waiter may exceed the limit since it already holds a
+             thread.
+
+DataFields:  queues:     queues of each worker
+             workers:    the threads
+             queued:     tasks waiting in the queues of each class
+             background: background tasks running
+             backgroundLimit: most background tasks run at once
+             next:       queue the next task from outside a worker goes to
+             executed:   tasks run
+             steals:     tasks taken from another worker's queue
+             lock:       guards sleeping on idle and stopping
+             idle:       signalled when a task is queued or on shutdown
+             stopping:   set by the destructor
+
+Functions:   Scheduler:   constructor; starts the workers
+             ~Scheduler:  destructor; finishes every queued task and stops
+             submit:      queue a task in a group
+             wait:        run tasks until every task of a group has finished
+             parallelFor: run a function over a range split into subtasks
+             getWorkers:  amount of workers
+             getExecuted: getter for executed
+             getSteals:   getter for steals
+             work:        loop run by every worker
+             take:        find a task, stealing if needed
+             execute:     run a task and account for it
+             split:       body of a parallelFor subtask
+=============================================================================*/
+class Scheduler
+{
+   private:
+      vector<WorkerQueue> queues;
+      vector<thread> workers;
+      atomic<long> queued[PRIORITY_CLASSES],
+                   background;
+      long backgroundLimit;
+      atomic<unsigned> next;
+      atomic<long> executed,
+                   steals;
+      mutex lock;
+      condition_variable idle;
+      bool stopping;
+
+      /* Not copyable */
+      Scheduler(const Scheduler &);
+      Scheduler & operator=(const Scheduler &);
+
+      void work(int);
+      bool take(int, Priority, bool, Task &);
+      void execute(Task &);
+      void split(TaskGroup &, size_t, size_t, size_t,
+                 const function<void(size_t, size_t)> &);
+
+   public:
+      Scheduler(unsigned);
+      ~Scheduler();
+
+      void submit(TaskGroup &, function<void()>);
+      void wait(TaskGroup &);
+      void parallelFor(Priority, size_t, size_t, size_t,
+                       const function<void(size_t, size_t)> &);
+
+      unsigned getWorkers(void) const;
+      long getExecuted(void) const;
+      long getSteals(void) const;
+};
+
+/* Scheduler shared by the whole program */
+Scheduler & scheduler(void);
+
+#endif
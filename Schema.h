@@ -0,0 +1,594 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Schema.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the templates that describe the
+             layout of a record. A schema lists the fields of a record in
+             order, each with the member it is stored in, its column width,
+             title, fill character and alignment. From that list the compiler
+             generates the column offsets, the row formatter and parser of the
+             datafile and the binary encoder and decoder of snapshots, each
+             specialized for the exact fields and free of per row allocation.
+             A schema over a record of string views parses rows in place,
+             without copying a field.
+
+             Adding a field, say an email, takes a member in the record and its
+             view and one more Field in the client layout, which both the
+             record's schema and the view's are made from:
+
+                Field<&Record::email, EMAIL_CHARACTERS, EMAIL_TITLE>
+
+             Every text and binary path picks it up from there.
+#############################################################################*/
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include<string>
+#include<string_view>
+#include<cstring>
+#include<charconv>
+#include<utility>
+#include<stdint.h>
+
+using namespace std;
+
+/*=============================================================================
+Struct:      MemberOf
+
+Description: Splits a pointer to a datafield into the record type and the
+             datafield's type.
+
+DataFields:  Record: type of the record holding the datafield
+             Value:  type of the datafield
+=============================================================================*/
+template<typename Pointer>
+struct MemberOf;
+
+template<typename RecordType, typename ValueType>
+struct MemberOf<ValueType RecordType :: *>
+{
+   typedef RecordType Record;
+   typedef ValueType Value;
+};
+
+/*=============================================================================
+Struct:      TextOf
+
+Description: The text of one value, ready to be copied into a row. Numbers are
+             converted into a small buffer; strings are used in place.
+
+DataFields:  data:   first character of the text
+             length: amount of characters
+             digits: buffer holding the text of a number
+=============================================================================*/
+template<typename Value>
+struct TextOf;
+
+template<>
+struct TextOf<int>
+{
+   /* Longest text of an int: sign and ten digits */
+   static constexpr size_t MOST = 11;
+
+   char digits[MOST];
+   const char *data;
+   size_t length;
+
+   TextOf(int value) : data(digits)
+   {
+      length = to_chars(digits, digits + MOST, value).ptr - digits;
+   }
+};
+
+template<>
+struct TextOf<string>
+{
+   const char *data;
+   size_t length;
+
+   TextOf(const string &value) : data(value.data()), length(value.size()) {}
+};
+
+template<>
+struct TextOf<string_view>
+{
+   const char *data;
+   size_t length;
+
+   TextOf(string_view value) : data(value.data()), length(value.size()) {}
+};
+
+/*-----------------------------------------------------------------------------
+Name:        textBound
+
+Description: Most characters the text of a value can take.
+
+Algorithm:   Numbers are bounded by the longest int; strings by their size.
+
+Parameters:  value: the value
+
+Output:      bound: most characters
+
+Result:      Bound is returned.
+------------------------------------------------------------------------------*/
+inline size_t textBound(int)
+{
+   return TextOf<int> :: MOST;
+}
+
+inline size_t textBound(const string &value)
+{
+   return value.size();
+}
+
+inline size_t textBound(string_view value)
+{
+   return value.size();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        readText
+
+Description: Read a value back from its text.
+
+Algorithm:   Numbers must use every character; strings must not be empty. A
+             string view is pointed at the text instead of copying it.
+
+Parameters:  begin: first character of the text
+             end:   end of the text
+             value: the value read
+
+Output:      true when the text holds a value
+
+Result:      value is set on success.
+------------------------------------------------------------------------------*/
+inline bool readText(const char *begin, const char *end, int &value)
+{
+   from_chars_result read = from_chars(begin, end, value);
+
+   return begin != end && read.ec == errc() && read.ptr == end;
+}
+
+inline bool readText(const char *begin, const char *end, string &value)
+{
+   value.assign(begin, end - begin);
+
+   return begin != end;
+}
+
+inline bool readText(const char *begin, const char *end, string_view &value)
+{
+   value = string_view(begin, end - begin);
+
+   return begin != end;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        putVarint
+
+Description: Append a variable length integer.
+
+Algorithm:   Seven bits per byte, lowest first, with the high bit set on every
+             byte but the last. Signed values are zigzag encoded so small
+             negative numbers stay short.
+
+Parameters:  out:   where to append
+             value: the integer
+
+Output:      void
+
+Result:      out holds the encoded integer.
+------------------------------------------------------------------------------*/
+inline void putVarint(string &out, int64_t value)
+{
+   uint64_t bits = (static_cast<uint64_t>(value) << 1) ^
+                   static_cast<uint64_t>(value >> 63);
+
+   while(bits >= 0x80)
+   {
+      out += static_cast<char>((bits & 0x7F) | 0x80);
+      bits >>= 7;
+   }
+   out += static_cast<char>(bits);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getVarint
+
+Description: Read a variable length integer.
+
+Algorithm:   Reverses putVarint, refusing to read past end or more than ten
+             bytes.
+
+Parameters:  at:    position to read from; moved past the integer
+             end:   end of the readable bytes
+             value: the integer
+
+Output:      true when a whole integer was read
+
+Result:      value and at are updated on success.
+------------------------------------------------------------------------------*/
+inline bool getVarint(const char *&at, const char *end, int64_t &value)
+{
+   uint64_t bits = 0;
+
+   for(int shift = 0; shift < 64 && at < end; shift += 7)
+   {
+      unsigned char byte = static_cast<unsigned char>(*at++);
+
+      bits |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if(!(byte & 0x80))
+      {
+         value = static_cast<int64_t>(bits >> 1) ^
+                 -static_cast<int64_t>(bits & 1);
+         return true;
+      }
+   }
+
+   /* Return value */
+   return false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        encodeValue
+
+Description: Append the binary form of a value.
+
+Algorithm:   Numbers are variable length integers; strings are their length as
+             a variable length integer followed by their bytes.
+
+Parameters:  out:   where to append
+             value: the value
+
+Output:      void
+
+Result:      out holds the encoded value.
+------------------------------------------------------------------------------*/
+inline void encodeValue(string &out, int value)
+{
+   putVarint(out, value);
+}
+
+inline void encodeValue(string &out, const string &value)
+{
+   putVarint(out, value.size());
+   out += value;
+}
+
+inline void encodeValue(string &out, string_view value)
+{
+   putVarint(out, value.size());
+   out += value;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        decodeValue
+
+Description: Read the binary form of a value.
+
+Algorithm:   Reverses encodeValue, refusing to read past end. A string view is
+             pointed at the bytes instead of copying them.
+
+Parameters:  at:    position to read from; moved past the value
+             end:   end of the readable bytes
+             value: the value read
+
+Output:      true when a whole value was read
+
+Result:      value and at are updated on success.
+------------------------------------------------------------------------------*/
+inline bool decodeValue(const char *&at, const char *end, int &value)
+{
+   int64_t wide;
+
+   if(!getVarint(at, end, wide))
+      return false;
+   value = wide;
+
+   /* Return value */
+   return true;
+}
+
+inline bool decodeValue(const char *&at, const char *end, string &value)
+{
+   int64_t length;
+
+   if(!getVarint(at, end, length) || length < 0 || length > end - at)
+      return false;
+
+   value.assign(at, length);
+   at += length;
+
+   /* Return value */
+   return true;
+}
+
+inline bool decodeValue(const char *&at, const char *end, string_view &value)
+{
+   int64_t length;
+
+   if(!getVarint(at, end, length) || length < 0 || length > end - at)
+      return false;
+
+   value = string_view(at, length);
+   at += length;
+
+   /* Return value */
+   return true;
+}
+
+/*=============================================================================
+Struct:      Field
+
+Description: One column of a schema.
+
+             Member is the datafield holding the value, Width the column width,
+             Title the column title, Fill the padding character and
+             RightAligned whether the padding goes before the value. A value
+             wider than its column is written whole, the way setw would.
+
+DataFields:  width: column width
+             title: column title
+
+Functions:   bound:       most characters the column can take for a record
+             pad:         write text padded to the column
+             format:      write the padded value of a record
+             formatTitle: write the padded title
+             parse:       read the value of a record from its column
+             encode:      append the binary form of the value
+             decode:      read the binary form of the value
+=============================================================================*/
+template<auto Member, int Width, const char *Title, char Fill = ' ',
+         bool RightAligned = false>
+struct Field
+{
+   typedef typename MemberOf<decltype(Member)> :: Record Record;
+   typedef typename MemberOf<decltype(Member)> :: Value Value;
+
+   static constexpr size_t width = Width;
+   static constexpr const char *title = Title;
+
+   static size_t bound(const Record &record)
+   {
+      size_t most = textBound(record.*Member);
+
+      return most > width ? most : width;
+   }
+
+   static char * pad(char *out, const char *data, size_t length, char fill)
+   {
+      size_t padding = length < width ? width - length : 0;
+
+      if constexpr(RightAligned)
+      {
+         memset(out, fill, padding);
+         memcpy(out + padding, data, length);
+      }
+      else
+      {
+         memcpy(out, data, length);
+         memset(out + length, fill, padding);
+      }
+
+      return out + padding + length;
+   }
+
+   static char * format(char *out, const Record &record)
+   {
+      TextOf<Value> text(record.*Member);
+
+      return pad(out, text.data, text.length, Fill);
+   }
+
+   static char * formatTitle(char *out)
+   {
+      size_t length = strlen(Title);
+      size_t padding = length < width ? width - length : 0;
+
+      /* Titles are always left aligned */
+      memcpy(out, Title, length);
+      memset(out + length, Fill, padding);
+
+      return out + length + padding;
+   }
+
+   static bool parse(const char *begin, const char *end, Record &record)
+   {
+      /* Strip the padding; zeros in front of a number are left to the
+         number parser */
+      if constexpr(RightAligned)
+      {
+         if(Fill != '0')
+            while(begin < end && *begin == Fill)
+               begin++;
+      }
+      else
+         while(end > begin && end[-1] == Fill)
+            end--;
+
+      return readText(begin, end, record.*Member);
+   }
+
+   static void encode(string &out, const Record &record)
+   {
+      encodeValue(out, record.*Member);
+   }
+
+   static bool decode(const char *&at, const char *end, Record &record)
+   {
+      return decodeValue(at, end, record.*Member);
+   }
+};
+
+/*=============================================================================
+Struct:      FirstOf
+
+Description: The first type of a list of types.
+
+DataFields:  Type: the first type
+=============================================================================*/
+template<typename First, typename... Rest>
+struct FirstOf
+{
+   typedef First Type;
+};
+
+/*=============================================================================
+Struct:      Schema
+
+Description: The layout of a record as a list of fields, each row ending with
+             the separator after every field and a new line.
+
+             A row whose fields all fit their columns has the fixed length
+             rowWidth and every field at a fixed offset, so such rows are
+             parsed by position. Any other row is parsed by splitting it on
+             whitespace.
+
+DataFields:  fieldCount:      amount of fields
+             separatorLength: length of the separator
+             rowWidth:        length of a row of fitting fields, without the new
+                              line
+
+Functions:   offset:       column offset of a field
+             separate:     write the separator
+             appendRow:    append the row of a record
+             appendHeader: append the row of titles
+             isFixed:      whether a row has a separator after every column
+             parseFixed:   read a record from the fixed columns of a row
+             parseTokens:  read a record from the whitespace split fields
+             parseRow:     read a record from a row
+             encode:       append the binary form of a record
+             decode:       read a record from its binary form
+=============================================================================*/
+template<const char *Separator, typename... Fields>
+struct Schema
+{
+   typedef typename FirstOf<Fields...> :: Type :: Record Record;
+
+   static constexpr size_t fieldCount = sizeof...(Fields);
+   static constexpr size_t separatorLength =
+      char_traits<char> :: length(Separator);
+   static constexpr size_t rowWidth =
+      (Fields :: width + ...) + fieldCount * separatorLength;
+
+   template<size_t Index>
+   static constexpr size_t offset(void)
+   {
+      const size_t widths[] = {Fields :: width...};
+      size_t at = 0;
+
+      for(size_t field = 0; field < Index; field++)
+         at += widths[field] + separatorLength;
+
+      return at;
+   }
+
+   static char * separate(char *out)
+   {
+      memcpy(out, Separator, separatorLength);
+
+      return out + separatorLength;
+   }
+
+   static void appendRow(string &out, const Record &record)
+   {
+      size_t start = out.size();
+
+      out.resize(start + (Fields :: bound(record) + ...) +
+                 fieldCount * separatorLength + 1);
+
+      char *at = &out[start];
+      ((at = separate(Fields :: format(at, record))), ...);
+      *at++ = '\n';
+
+      out.resize(at - out.data());
+   }
+
+   static void appendHeader(string &out)
+   {
+      size_t start = out.size();
+
+      out.resize(start + ((strlen(Fields :: title) + Fields :: width) + ...) +
+                 fieldCount * separatorLength + 1);
+
+      char *at = &out[start];
+      ((at = separate(Fields :: formatTitle(at))), ...);
+      *at++ = '\n';
+
+      out.resize(at - out.data());
+   }
+
+   template<size_t... Index>
+   static bool isFixed(const char *begin, index_sequence<Index...>)
+   {
+      return ((memcmp(begin + offset<Index>() + Fields :: width, Separator,
+                      separatorLength) == 0) && ...);
+   }
+
+   template<size_t... Index>
+   static bool parseFixed(const char *begin, Record &record,
+                          index_sequence<Index...>)
+   {
+      return (Fields :: parse(begin + offset<Index>(),
+                              begin + offset<Index>() + Fields :: width,
+                              record) && ...);
+   }
+
+   template<size_t... Index>
+   static bool parseTokens(const char * const *tokens, Record &record,
+                           index_sequence<Index...>)
+   {
+      return (Fields :: parse(tokens[2 * Index], tokens[2 * Index + 1],
+                              record) && ...);
+   }
+
+   static bool parseRow(const char *begin, const char *end, Record &record)
+   {
+      const char *tokens[2 * fieldCount]; /* start and end of each field */
+      size_t count = 0;                   /* fields found */
+
+      while(end > begin && (end[-1] == '\n' || end[-1] == '\r'))
+         end--;
+
+      /* Every field fits its column */
+      if(static_cast<size_t>(end - begin) == rowWidth &&
+         isFixed(begin, index_sequence_for<Fields...>()))
+         return parseFixed(begin, record, index_sequence_for<Fields...>());
+
+      /* Split on whitespace */
+      for(const char *at = begin; ; )
+      {
+         while(at < end && (*at == ' ' || *at == '\t'))
+            at++;
+         if(at >= end)
+            break;
+         if(count == fieldCount)
+            return false;
+
+         tokens[2 * count] = at;
+         while(at < end && *at != ' ' && *at != '\t')
+            at++;
+         tokens[2 * count + 1] = at;
+         count++;
+      }
+
+      return count == fieldCount &&
+             parseTokens(tokens, record, index_sequence_for<Fields...>());
+   }
+
+   static void encode(string &out, const Record &record)
+   {
+      (Fields :: encode(out, record), ...);
+   }
+
+   static bool decode(const char *&at, const char *end, Record &record)
+   {
+      return (Fields :: decode(at, end, record) && ...);
+   }
+};
+
+#endif
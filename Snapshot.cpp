@@ -0,0 +1,414 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Snapshot.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the class Snapshot. A dump
+             reads the datafile and streams every client into blocks of a
+             binary snapshot. A load checks and decodes a snapshot block by
+             block and writes a new datafile and occupancy in the same pass.
+#############################################################################*/
+#include<cstdio>
+#include<algorithm>
+#include<stdint.h>
+#include "Snapshot.h"
+#include "Client.h"
+#include "AsyncIO.h"
+#include "Schema.h"
+#include "LookupCache.h"
+#include "Version.h"
+
+/* Layout of a snapshot */
+static const char SNAPSHOT_MAGIC[] = "DBSNAP\r\n";  /* first 8 bytes */
+static const uint32_t SNAPSHOT_VERSION = 1;         /* format version */
+static const size_t SNAPSHOT_MAGIC_BYTES = 8;       /* length of the magic */
+static const size_t SNAPSHOT_HEADER_BYTES = 16;     /* magic, version and block
+                                                       size */
+static const size_t BLOCK_HEADER_BYTES = 12;        /* length, records, crc */
+static const size_t BLOCK_BYTES = 1 << 20;          /* target payload size */
+
+/* Debug messages */
+static const char CREATE_SNAPSHOT[] = "[Snapshot object has been created]\n";
+static const char DESTROY_SNAPSHOT[] =
+   "[Snapshot object has been deallocated]\n";
+static const char DUMP[] = "[Dumping to... ";
+static const char LOAD[] = "[Loading from... ";
+
+/*-----------------------------------------------------------------------------
+Name:        crc32
+
+Description: Extend a CRC-32 checksum over more bytes.
+
+Algorithm:   Standard reflected CRC-32 using a 256 entry table that is built
+             the first time it is needed.
+
+Parameters:  crc:    checksum of the bytes before data; 0 to start
+             data:   bytes to add
+             length: amount of bytes
+
+Output:      crc: checksum including data
+
+Result:      Updated checksum is returned.
+------------------------------------------------------------------------------*/
+static uint32_t crc32(uint32_t crc, const char *data, size_t length)
+{
+   static uint32_t table[256];
+   static bool tableBuilt = false;
+
+   if(!tableBuilt)
+   {
+      for(uint32_t entry = 0; entry < 256; entry++)
+      {
+         uint32_t value = entry;
+         for(int bit = 0; bit < 8; bit++)
+            value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+         table[entry] = value;
+      }
+      tableBuilt = true;
+   }
+
+   crc = ~crc;
+   for(size_t at = 0; at < length; at++)
+      crc = table[(crc ^ static_cast<unsigned char>(data[at])) & 0xFF] ^
+            (crc >> 8);
+
+   /* Return value */
+   return ~crc;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        putU32
+
+Description: Append a 4 byte little endian integer.
+
+Algorithm:   Appends the value one byte at a time, lowest first.
+
+Parameters:  out:   where to append
+             value: the integer
+
+Output:      void
+
+Result:      out is 4 bytes longer.
+------------------------------------------------------------------------------*/
+static void putU32(string &out, uint32_t value)
+{
+   for(int byte = 0; byte < 4; byte++)
+      out += static_cast<char>((value >> (8 * byte)) & 0xFF);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getU32
+
+Description: Read a 4 byte little endian integer.
+
+Algorithm:   Combines the bytes, lowest first.
+
+Parameters:  data: the 4 bytes
+
+Output:      value: the integer
+
+Result:      Integer is returned.
+------------------------------------------------------------------------------*/
+static uint32_t getU32(const char *data)
+{
+   uint32_t value = 0;
+
+   for(int byte = 3; byte >= 0; byte--)
+      value = (value << 8) | static_cast<unsigned char>(data[byte]);
+
+   /* Return value */
+   return value;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        Snapshot
+
+Description: Default constructor.
+
+Algorithm:   Outputs prompt of being called if debug is on.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Snapshot object is allocated.
+------------------------------------------------------------------------------*/
+Snapshot :: Snapshot()
+{
+   /* Debug message */
+   if(debug)
+      cerr << CREATE_SNAPSHOT;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~Snapshot
+
+Description: Destructor.
+
+Algorithm:   Outputs prompt of being called if debug is on.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Snapshot object is deallocated.
+------------------------------------------------------------------------------*/
+Snapshot :: ~Snapshot()
+{
+   /* Debug message */
+   if(debug)
+      cerr << DESTROY_SNAPSHOT;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        dump
+
+Description: Write every client to a snapshot file.
+
+Algorithm:   A snapshot of the database is pinned and its committed part
+             mapped, so inserts carry on while the dump runs and are not
+             included. Each client row is parsed in place and encoded into the
+             current block, without copying its fields. Whenever a
+             block reaches BLOCK_BYTES its header and payload are handed to a
+             StreamWriter, which keeps writing while the next block is encoded.
+             The trailer is added after the last block. The snapshot is written
+             beside path and renamed over it once complete so a failed dump
+             never leaves a partial file.
+
+Parameters:  path: snapshot file to write
+
+Output:      total: amount of clients written, or -1 on failure
+
+Result:      path holds a snapshot of the database.
+------------------------------------------------------------------------------*/
+long Snapshot :: dump(const string &path)
+{
+   /* Debug message */
+   if(debug)
+      cerr << DUMP << path << "]" << endl;
+
+   const string TEMPORARY = path + ".tmp"; /* file written before renaming */
+   ReadView view;                /* snapshot being dumped */
+   ClientRows rows(view.map());  /* clients of the datafile */
+   string header,                /* file, block and trailer headers */
+          payload;               /* records of the current block */
+   StreamWriter out;             /* writes the snapshot */
+   uint32_t blockRecords = 0,    /* records in the current block */
+            fileCrc = 0;         /* checksum of every payload */
+   long total = 0;               /* records written */
+
+   if(!out.open(TEMPORARY))
+      return -1;
+
+   /* File header */
+   header.assign(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_BYTES);
+   putU32(header, SNAPSHOT_VERSION);
+   putU32(header, BLOCK_BYTES);
+   out.write(header);
+   payload.reserve(BLOCK_BYTES + 256);
+
+   /* Encode every client row, closing a block whenever it is full */
+   for(ClientRows :: iterator at = rows.begin(); at != rows.end(); )
+   {
+      ClientViewSchema :: encode(payload, *at);
+      blockRecords++;
+      total++;
+      ++at;
+
+      if(payload.size() >= BLOCK_BYTES || at == rows.end())
+      {
+         header.clear();
+         putU32(header, payload.size());
+         putU32(header, blockRecords);
+         putU32(header, crc32(0, payload.data(), payload.size()));
+         out.write(header);
+         out.write(payload);
+
+         fileCrc = crc32(fileCrc, payload.data(), payload.size());
+         payload.clear();
+         blockRecords = 0;
+      }
+   }
+
+   /* Trailer */
+   header.clear();
+   putU32(header, 0);
+   putU32(header, total);
+   putU32(header, fileCrc);
+   out.write(header);
+
+   if(!out.close() || rename(TEMPORARY.c_str(), path.c_str()) != 0)
+   {
+      remove(TEMPORARY.c_str());
+      return -1;
+   }
+
+   /* Return value */
+   return total;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        takeBytes
+
+Description: Take the next bytes of a stream.
+
+Algorithm:   Copies bytes from the block being read, asking the reader for
+             the next block whenever it is used up, until enough are taken.
+
+Parameters:  reader: the stream
+             block:  bytes of the current block not yet taken
+             length: amount of bytes to take
+             out:    the bytes taken
+
+Output:      true when length bytes were taken; false at the end of the
+             stream or on a failed read
+
+Result:      out holds the bytes and block what follows them.
+------------------------------------------------------------------------------*/
+static bool takeBytes(StreamReader &reader, string_view &block, size_t length,
+                      string &out)
+{
+   out.clear();
+   while(out.size() < length)
+   {
+      if(block.empty() && !reader.next(block))
+         return false;
+
+      size_t part = min(length - out.size(), block.size());
+      out.append(block.data(), part);
+      block.remove_prefix(part);
+   }
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        load
+
+Description: Replace the database with the clients of a snapshot.
+
+Algorithm:   The snapshot is streamed through a StreamReader, so only the
+             block being decoded is held in memory however large the snapshot
+             is. Its header is checked first. Each block's checksum is verified
+             before its records are decoded, formatted as rows and streamed
+             into a new datafile, so the whole database is rebuilt in one pass.
+             A block longer than twice the snapshot's block size is damaged.
+             The trailer must match the amount of records and the checksum of
+             every payload and end the file. The new datafile is written to a
+             file of this process's own, so loads in other processes never
+             touch it. Only then is it installed as the next generation with
+             the new occupancy, under the write lock, and the lookup cache
+             cleared; a damaged snapshot, or failing to take the lock, leaves
+             the database untouched. Readers
+             pinned to the old generation finish against it.
+
+Parameters:  path: snapshot file to read
+
+Output:      total: amount of clients loaded, or -1 on failure
+
+Result:      The database holds exactly the clients of the snapshot.
+------------------------------------------------------------------------------*/
+long Snapshot :: load(const string &path)
+{
+   /* Debug message */
+   if(debug)
+      cerr << LOAD << path << "]" << endl;
+
+   const string TEMPORARY = loadFile(); /* new datafile */
+   StreamReader in;                     /* reads the snapshot */
+   string_view block;                   /* bytes read and not yet taken */
+   string header,                       /* file or block header */
+          payload;                      /* records of the current block */
+   StreamWriter out;                    /* writes the new datafile */
+   ClientRecord record;                 /* client being decoded */
+   string rows;                         /* rows of the current block */
+   uint32_t blockLimit,                 /* longest payload accepted */
+            fileCrc = 0;                /* checksum of every payload */
+   long total = 0;                      /* records decoded */
+   bool isValid = false;                /* trailer was reached and matched */
+
+   if(!in.open(path))
+      return -1;
+
+   /* Check the file header */
+   if(!takeBytes(in, block, SNAPSHOT_HEADER_BYTES, header) ||
+      header.compare(0, SNAPSHOT_MAGIC_BYTES, SNAPSHOT_MAGIC) != 0 ||
+      getU32(header.data() + SNAPSHOT_MAGIC_BYTES) != SNAPSHOT_VERSION)
+   {
+      in.close();
+      return -1;
+   }
+   blockLimit = 2 * getU32(header.data() + SNAPSHOT_MAGIC_BYTES + 4);
+
+   if(!out.open(TEMPORARY))
+   {
+      in.close();
+      return -1;
+   }
+   out.write(fileHeader());
+
+   /* Verify and decode block by block */
+   while(takeBytes(in, block, BLOCK_HEADER_BYTES, header))
+   {
+      uint32_t length = getU32(header.data());
+      uint32_t records = getU32(header.data() + 4);
+      uint32_t crc = getU32(header.data() + 8);
+
+      /* Trailer; nothing may follow it */
+      if(length == 0)
+      {
+         isValid = records == total && crc == fileCrc && block.empty() &&
+                   !in.next(block);
+         break;
+      }
+
+      if(length > blockLimit || !takeBytes(in, block, length, payload) ||
+         crc32(0, payload.data(), length) != crc)
+         break;
+      fileCrc = crc32(fileCrc, payload.data(), length);
+
+      const char *at = payload.data();
+      const char *blockEnd = at + length;
+      uint32_t decoded;
+
+      rows.clear();
+      for(decoded = 0; decoded < records; decoded++)
+      {
+         if(!ClientSchema :: decode(at, blockEnd, record))
+            break;
+         ClientSchema :: appendRow(rows, record);
+      }
+      out.write(rows);
+      total += decoded;
+
+      if(decoded != records || at != blockEnd)
+         break;
+   }
+
+   /* Keep the old database unless the whole snapshot was good */
+   if(!in.close())
+      isValid = false;
+   if(!out.close() || !isValid)
+   {
+      remove(TEMPORARY.c_str());
+      return -1;
+   }
+
+   {
+      WriteLock writer; /* excludes other writers during the swap */
+
+      if(!writer.isHeld() || !installGeneration(TEMPORARY, total))
+      {
+         remove(TEMPORARY.c_str());
+         return -1;
+      }
+   }
+   lookupCache().clear();
+
+   /* Return value */
+   return total;
+}
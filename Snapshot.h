@@ -0,0 +1,55 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Snapshot.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definition of the class
+             Snapshot, which dumps the whole database to a compact binary file
+             and loads it back.
+#############################################################################*/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include<string>
+
+using namespace std;
+
+/*=============================================================================
+Class:       Snapshot
+
+Description: Exports and imports every client in a checksummed binary format.
+
+             A snapshot starts with an 8 byte magic string, a 4 byte version
+             and the 4 byte target block size. It is followed by blocks, each
+             with a 12 byte header holding the payload length, the amount of
+             records and the CRC-32 of the payload. A block with an empty
+             payload ends the file; its record count is the total amount of
+             records and its checksum is the CRC-32 of every payload in order.
+             Integers in headers are 4 byte little endian. In a payload each
+             record is encoded field by field as the client schema lists them:
+             numbers as variable length integers and strings as their length
+             followed by their bytes.
+
+DataFields:  none
+
+Functions:   Snapshot:  constructor
+             ~Snapshot: destructor
+             dump:      write every client to a snapshot file
+             load:      replace the database with the clients of a snapshot
+=============================================================================*/
+class Snapshot
+{
+   public:
+      /* Constructor and destructor */
+      Snapshot();
+      ~Snapshot();
+
+      /* Export and import */
+      long dump(const string &);
+      long load(const string &);
+};
+
+#endif
@@ -0,0 +1,283 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  StorageEngine.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the functions of the class FlatFileEngine,
+             which passes each operation on to Client and FileManager.
+#############################################################################*/
+#include<sstream>
+#include "StorageEngine.h"
+#include "Version.h"
+
+/*-----------------------------------------------------------------------------
+Name:        FlatFileEngine
+
+Description: Constructor.
+
+Algorithm:   Allocates the FileManager.
+
+Parameters:  none
+
+Output:      none
+
+Result:      FlatFileEngine object is allocated.
+------------------------------------------------------------------------------*/
+FlatFileEngine :: FlatFileEngine() : files(new FileManager())
+{
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~FlatFileEngine
+
+Description: Destructor.
+
+Algorithm:   Flushes the commits to the device unless each was already
+             flushed, then deallocates the FileManager.
+
+Parameters:  none
+
+Output:      none
+
+Result:      FlatFileEngine object is deallocated.
+------------------------------------------------------------------------------*/
+FlatFileEngine :: ~FlatFileEngine()
+{
+   if(!ioEngine().getCommitSync())
+      syncCommits();
+   delete files;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        open
+
+Description: Get the stored database ready for use.
+
+Algorithm:   Removes the files of loads a crash cut short, then makes a fresh
+             datafile when there are no clients; occupancy of 0.
+
+Parameters:  none
+
+Output:      true
+
+Result:      The datafile exists.
+------------------------------------------------------------------------------*/
+bool FlatFileEngine :: open(void)
+{
+   sweepLoads();
+   if(client.updateOccupancy(false) == 0)
+      files->makeFile();
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        occupancy
+
+Description: Amount of clients in the database.
+
+Algorithm:   Reads the occupancy from the commit record.
+
+Parameters:  none
+
+Output:      occupancy: amount of clients
+
+Result:      Occupancy is returned.
+------------------------------------------------------------------------------*/
+int FlatFileEngine :: occupancy(void)
+{
+   /* Return value */
+   return client.updateOccupancy(false);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        insert
+
+Description: Add a client with the next occupant number.
+
+Algorithm:   Appends the client's row through Client :: insert.
+
+Parameters:  nm:   name of client
+             id:   I.D. of client
+             bday: birthday of client
+
+Output:      isInserted: whether the client was committed
+
+Result:      The client is in the datafile.
+------------------------------------------------------------------------------*/
+bool FlatFileEngine :: insert(const string &nm, const string &id, int bday)
+{
+   /* Return value */
+   return client.insert(occupancy(), nm, id, bday);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        lookup
+
+Description: Find the first client with a name.
+
+Algorithm:   Searches through Client :: lookup.
+
+Parameters:  nm:     name of client to search
+             record: the client found
+
+Output:      isFound: whether a client with the name exists
+
+Result:      record holds the client found.
+------------------------------------------------------------------------------*/
+bool FlatFileEngine :: lookup(const string &nm, ClientRecord &record)
+{
+   /* Return value */
+   return client.lookup(nm, record);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        prefix
+
+Description: Clients whose names start with a text.
+
+Algorithm:   Asks the name index for a snapshot of the datafile. Should a reset
+             replace the datafile while the index serves another snapshot, the
+             index cannot answer for the older one and a new snapshot is tried.
+
+Parameters:  text:  the prefix; "" matches every name
+             found: the clients, by name and then occupant number
+
+Output:      void
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+void FlatFileEngine :: prefix(const string &text, vector<NameEntry> &found)
+{
+   found.clear();
+   if(!nameIndex().prefix(ReadView(), text, found))
+      nameIndex().prefix(ReadView(), text, found);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        range
+
+Description: Clients whose names lie between two names.
+
+Algorithm:   Asks the name index as prefix does.
+
+Parameters:  first: lowest name
+             last:  highest name
+             found: the clients, by name and then occupant number
+
+Output:      void
+
+Result:      found holds the clients.
+------------------------------------------------------------------------------*/
+void FlatFileEngine :: range(const string &first, const string &last,
+                             vector<NameEntry> &found)
+{
+   found.clear();
+   if(!nameIndex().range(ReadView(), first, last, found))
+      nameIndex().range(ReadView(), first, last, found);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        reset
+
+Description: Remove every client.
+
+Algorithm:   Swaps in an empty generation through Client :: reset.
+
+Parameters:  none
+
+Output:      void
+
+Result:      The database is empty.
+------------------------------------------------------------------------------*/
+void FlatFileEngine :: reset(void)
+{
+   client.reset();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        write
+
+Description: Contents of the database as the (w)Write command prints them.
+
+Algorithm:   Returns FileManager :: outputFile.
+
+Parameters:  none
+
+Output:      content: the datafile without its whitespace
+
+Result:      Content is returned.
+------------------------------------------------------------------------------*/
+string FlatFileEngine :: write(void)
+{
+   /* Return value */
+   return files->outputFile();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        describe
+
+Description: Engine specific metrics for the (s)Stats command.
+
+Algorithm:   Reports the generation and committed size of the datafile, and
+             the name index on a second line.
+
+Parameters:  none
+
+Output:      text: one line of metrics
+
+Result:      Text is returned.
+------------------------------------------------------------------------------*/
+string FlatFileEngine :: describe(void)
+{
+   Manifest manifest;  /* the commit record */
+   ostringstream text; /* the metrics */
+
+   readManifest(manifest);
+   text << "Flat file engine: generation " << manifest.generation << ", "
+        << (manifest.bytes > 0 ? manifest.bytes : 0) << " byte(s) in "
+        << manifest.file << "." << endl << nameIndex().describe();
+
+   /* Return value */
+   return text.str();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        hasDataFile
+
+Description: Whether the clients are rows of the datafile.
+
+Algorithm:   Returns true.
+
+Parameters:  none
+
+Output:      true
+
+Result:      Status is returned.
+------------------------------------------------------------------------------*/
+bool FlatFileEngine :: hasDataFile(void) const
+{
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        name
+
+Description: Name of the engine for messages.
+
+Algorithm:   Returns "flat file".
+
+Parameters:  none
+
+Output:      name: the engine's name
+
+Result:      Name is returned.
+------------------------------------------------------------------------------*/
+const char * FlatFileEngine :: name(void) const
+{
+   return "flat file";
+}
@@ -0,0 +1,108 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  StorageEngine.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definition of the interface
+             every storage engine of the database implements, and of the flat
+             file engine that keeps the clients as rows of the datafile.
+#############################################################################*/
+#ifndef STORAGEENGINE_H
+#define STORAGEENGINE_H
+
+#include<string>
+#include<vector>
+#include "Client.h"
+#include "NameIndex.h"
+
+using namespace std;
+
+class FileManager;
+
+/*=============================================================================
+Class:       StorageEngine
+
+Description: The operations the driver performs on the database, whichever way
+             the clients are stored.
+
+Functions:   ~StorageEngine: destructor
+             open:           get the stored database ready for use
+             occupancy:      amount of clients in the database
+             insert:         add a client with the next occupant number; false
+                             when it could not be stored
+             lookup:         find the first client with a name
+             prefix:         clients whose names start with a text
+             range:          clients whose names lie between two names
+             reset:          remove every client
+             write:          contents of the database as the (w)Write command
+                             prints them
+             describe:       engine specific metrics for the (s)Stats command
+             hasDataFile:    whether the clients are rows of the datafile, which
+                             the snapshot and CSV commands work on
+             name:           name of the engine for messages
+=============================================================================*/
+class StorageEngine
+{
+   public:
+      virtual ~StorageEngine() {}
+
+      virtual bool open(void) = 0;
+      virtual int occupancy(void) = 0;
+      virtual bool insert(const string &, const string &, int) = 0;
+      virtual bool lookup(const string &, ClientRecord &) = 0;
+      virtual void prefix(const string &, vector<NameEntry> &) = 0;
+      virtual void range(const string &, const string &,
+                         vector<NameEntry> &) = 0;
+      virtual void reset(void) = 0;
+      virtual string write(void) = 0;
+      virtual string describe(void) = 0;
+      virtual bool hasDataFile(void) const = 0;
+      virtual const char * name(void) const = 0;
+};
+
+/*=============================================================================
+Class:       FlatFileEngine
+
+Description: Keeps every client as a row appended to the datafile. Inserts are
+             a single append; lookups and name queries go through the name
+             index, with the lookup cache in front of lookups.
+
+DataFields:  client: performs the database operations
+             files:  creates and writes out the datafile
+
+Functions:   FlatFileEngine:  constructor
+             ~FlatFileEngine: destructor
+             open, occupancy, insert, lookup, prefix, range, reset, write,
+             describe, hasDataFile, name: as for StorageEngine
+=============================================================================*/
+class FlatFileEngine : public StorageEngine
+{
+   private:
+      Client client;
+      FileManager *files;
+
+      /* Not copyable */
+      FlatFileEngine(const FlatFileEngine &);
+      FlatFileEngine & operator=(const FlatFileEngine &);
+
+   public:
+      FlatFileEngine();
+      ~FlatFileEngine();
+
+      bool open(void);
+      int occupancy(void);
+      bool insert(const string &, const string &, int);
+      bool lookup(const string &, ClientRecord &);
+      void prefix(const string &, vector<NameEntry> &);
+      void range(const string &, const string &, vector<NameEntry> &);
+      void reset(void);
+      string write(void);
+      string describe(void);
+      bool hasDataFile(void) const;
+      const char * name(void) const;
+};
+
+#endif
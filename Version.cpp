@@ -0,0 +1,840 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Version.cpp
+
+------------------------------------------------------------------------------
+Description: This file contains the commit record functions and the classes
+             WriteLock and ReadView. A row becomes visible only once the
+             commit record counting its bytes has been renamed into place, and
+             a new generation of the datafile becomes visible only once the
+             commit record naming its file has. Readers check the inode of
+             the datafile they opened against the commit record they read, so
+             they never mix one generation's record with another's file. The
+             class Reclaimer removes the files of replaced generations in the
+             background.
+#############################################################################*/
+#include<cerrno>
+#include<cstdio>
+#include<sstream>
+#include<thread>
+#include<chrono>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<signal.h>
+#include<sys/file.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include "Version.h"
+#include "AsyncIO.h"
+
+/* Times a reader tries to pin a snapshot while a writer is replacing the
+   datafile, and how long it waits between tries */
+static const int PIN_ATTEMPTS = 1000;
+static const int PIN_WAIT_MICROSECONDS = 100;
+
+/*-----------------------------------------------------------------------------
+Name:        readManifest
+
+Description: Read the commit record.
+
+Algorithm:   The occupancy file holds the occupancy followed by the generation,
+             the committed bytes, the inode and the name of the datafile. A file
+             written before commit records existed holds only the occupancy;
+             the other fields are then unknown. A record without a file name
+             names DATA_FILE. A missing file is an empty database.
+
+Parameters:  manifest: the commit record read
+
+Output:      true when the occupancy file could be read
+
+Result:      manifest is filled in.
+------------------------------------------------------------------------------*/
+bool readManifest(Manifest &manifest)
+{
+   string text = ioEngine().readFile(OCCUPANCY_FILE); /* the commit record */
+   istringstream fields(text);                       /* its fields */
+
+   manifest.occupancy = 0;
+   manifest.generation = 0;
+   manifest.bytes = -1;
+   manifest.inode = 0;
+   manifest.file = DATA_FILE;
+
+   if(!(fields >> manifest.occupancy))
+   {
+      manifest.occupancy = 0;
+      return false;
+   }
+
+   if(!(fields >> manifest.generation >> manifest.bytes >> manifest.inode))
+   {
+      manifest.generation = 0;
+      manifest.bytes = -1;
+      manifest.inode = 0;
+   }
+   else if(!(fields >> manifest.file))
+      manifest.file = DATA_FILE;
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        publishManifest
+
+Description: Atomically replace the commit record.
+
+Algorithm:   The record is written to a temporary file which is then renamed
+             over the occupancy file, so a reader sees either the old record
+             or the new one whole. When the record must be durable, the
+             datafile it names and the temporary file are flushed to the
+             device before the rename, and the directory after it, so after a
+             power loss the record never counts bytes that were not stored.
+             The flushes about double the time an append takes, so appends
+             are only flushed when the IOEngine asks for every commit to be;
+             otherwise syncCommits flushes them at exit and WriteLock clamps
+             a record that outlived its rows. Must be called with a WriteLock
+             held.
+
+Parameters:  manifest:  the new commit record
+             isDurable: flush it to the device whatever the commit policy
+
+Output:      true when the record was replaced
+
+Result:      manifest is the commit record of the database.
+------------------------------------------------------------------------------*/
+bool publishManifest(const Manifest &manifest, bool isDurable)
+{
+   const string TEMPORARY = string(OCCUPANCY_FILE) + ".tmp"; /* new record */
+   ostringstream text;                                      /* its fields */
+
+   text << manifest.occupancy << ' ' << manifest.generation << ' '
+        << manifest.bytes << ' ' << manifest.inode << ' ' << manifest.file;
+
+   isDurable = isDurable || ioEngine().getCommitSync();
+   if((isDurable && !ioEngine().syncFile(manifest.file)) ||
+      !ioEngine().writeFile(TEMPORARY, text.str()) ||
+      (isDurable && !ioEngine().syncFile(TEMPORARY)) ||
+      rename(TEMPORARY.c_str(), OCCUPANCY_FILE) != 0)
+      return false;
+
+   /* The record is replaced; flushing its name only makes that durable */
+   if(isDurable)
+      ioEngine().syncFile(".");
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        commitAppend
+
+Description: Commit rows appended to the datafile.
+
+Algorithm:   Publishes a commit record of the same generation whose committed
+             length is the current size of the datafile. Must be called with a
+             WriteLock held, after the rows are written.
+
+Parameters:  occupancy: amount of clients including the appended ones
+
+Output:      true when the rows are committed
+
+Result:      Readers pinning a snapshot from now on see the appended rows.
+------------------------------------------------------------------------------*/
+bool commitAppend(int occupancy)
+{
+   Manifest manifest; /* commit record being replaced */
+   struct stat info;  /* size and inode of the datafile */
+
+   readManifest(manifest);
+   if(stat(manifest.file.c_str(), &info) < 0)
+      return false;
+
+   manifest.occupancy = occupancy;
+   manifest.bytes = info.st_size;
+   manifest.inode = info.st_ino;
+
+   /* Return value */
+   return publishManifest(manifest, false);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        syncCommits
+
+Description: Make every commit so far durable.
+
+Algorithm:   Flushes the datafile the commit record names, the record and the
+             directory holding them to the device.
+
+Parameters:  none
+
+Output:      true when all three are on the device
+
+Result:      A power loss no longer loses the committed clients.
+------------------------------------------------------------------------------*/
+bool syncCommits(void)
+{
+   Manifest manifest; /* commit record to flush */
+
+   readManifest(manifest);
+
+   /* Return value */
+   return ioEngine().syncFile(manifest.file) &&
+          ioEngine().syncFile(OCCUPANCY_FILE) && ioEngine().syncFile(".");
+}
+
+/*-----------------------------------------------------------------------------
+Name:        generationFile
+
+Description: Name of the datafile of a generation.
+
+Algorithm:   Joins the prefix, the generation and the suffix.
+
+Parameters:  generation: the generation
+
+Output:      name: file holding the generation
+
+Result:      The name is returned.
+------------------------------------------------------------------------------*/
+string generationFile(long generation)
+{
+   /* Return value */
+   return DATA_FILE_PREFIX + to_string(generation) + DATA_FILE_SUFFIX;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        installGeneration
+
+Description: Make a fully written file the next generation of the datafile.
+
+Algorithm:   The file is renamed to the name of the next generation, which no
+             file holds, and a commit record pointing at it is published. That
+             switch is the whole cost however large the old datafile is: the
+             old file is left to the reclaimer, and readers pinned to the old
+             generation keep reading it. Must be called with a WriteLock held.
+
+Parameters:  path:      the new datafile
+             occupancy: amount of clients in it
+
+Output:      true when the new generation is in place
+
+Result:      The database is the contents of path.
+------------------------------------------------------------------------------*/
+bool installGeneration(const string &path, int occupancy)
+{
+   Manifest manifest; /* commit record being replaced */
+   struct stat info;  /* size and inode of the new datafile */
+
+   readManifest(manifest);
+   manifest.occupancy = occupancy;
+   manifest.generation++;
+   manifest.file = generationFile(manifest.generation);
+
+   if(stat(path.c_str(), &info) < 0 ||
+      rename(path.c_str(), manifest.file.c_str()) != 0)
+      return false;
+
+   manifest.bytes = info.st_size;
+   manifest.inode = info.st_ino;
+   if(!publishManifest(manifest, true))
+      return false;
+
+   /* Older generations are no longer reachable from the commit record */
+   reclaimer().retire(manifest.generation);
+
+   /* Return value */
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        loadFile
+
+Description: File a load writes the next datafile to.
+
+Algorithm:   Joins DATA_FILE, LOAD_SUFFIX and the process I.D., so loads run
+             by different processes at once never write the same file.
+
+Parameters:  none
+
+Output:      name: file of this process's load
+
+Result:      The name is returned.
+------------------------------------------------------------------------------*/
+string loadFile(void)
+{
+   /* Return value */
+   return string(DATA_FILE) + LOAD_SUFFIX + "." + to_string(getpid());
+}
+
+/*-----------------------------------------------------------------------------
+Name:        sweepLoads
+
+Description: Remove the files of loads that never finished.
+
+Algorithm:   Scans the working directory for load files and unlinks those whose
+             process is no longer running, since a crash during a load leaves
+             its file behind. A load file without a process I.D. can only be
+             left over and is unlinked as well. Files of loads still running in
+             other processes are kept.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Only load files of running processes remain on disk.
+------------------------------------------------------------------------------*/
+void sweepLoads(void)
+{
+   const string PREFIX = string(DATA_FILE) + LOAD_SUFFIX; /* load files */
+   DIR *directory = opendir(".");  /* the working directory */
+   struct dirent *entry;           /* file being considered */
+
+   if(directory == NULL)
+      return;
+
+   while((entry = readdir(directory)) != NULL)
+   {
+      string name = entry->d_name;
+
+      if(name.compare(0, PREFIX.size(), PREFIX) != 0)
+         continue;
+
+      if(name.size() == PREFIX.size())
+      {
+         unlink(name.c_str());
+         continue;
+      }
+
+      /* The part after the prefix must be a dot and a process I.D. */
+      string number = name.substr(PREFIX.size() + 1);
+      if(name[PREFIX.size()] != '.' || number.empty() ||
+         number.find_first_not_of("0123456789") != string :: npos)
+         continue;
+
+      if(kill(stol(number), 0) < 0 && errno == ESRCH)
+         unlink(name.c_str());
+   }
+
+   closedir(directory);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        WriteLock
+
+Description: Constructor.
+
+Algorithm:   Takes an exclusive lock on the lock file, waiting for any other
+             writer. If the lock file cannot be opened or locked, nothing else
+             is done and the lock is not held. The commit record is then read
+             and checked against the datafile. A record that does not know the
+             datafile, or names a different one, adopts the datafile as it is.
+             Bytes past the committed length were appended by a writer that
+             never committed them and are cut off.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The caller is the only writer of the database, if the lock is held.
+------------------------------------------------------------------------------*/
+WriteLock :: WriteLock()
+{
+   struct stat info; /* size and inode of the datafile */
+   int locked;       /* result of flock */
+
+   readManifest(manifest);
+   fd = open(LOCK_FILE, O_RDWR | O_CREAT, 0644);
+   if(fd < 0)
+      return;
+
+   while((locked = flock(fd, LOCK_EX)) < 0 && errno == EINTR)
+      ;
+   if(locked < 0)
+   {
+      close(fd);
+      fd = -1;
+      return;
+   }
+
+   readManifest(manifest);
+   if(stat(manifest.file.c_str(), &info) < 0)
+      return;
+
+   if(manifest.bytes < 0 || manifest.inode != info.st_ino ||
+      manifest.bytes > info.st_size)
+   {
+      manifest.bytes = info.st_size;
+      manifest.inode = info.st_ino;
+      publishManifest(manifest, false);
+   }
+   else if(manifest.bytes < info.st_size)
+      truncate(manifest.file.c_str(), manifest.bytes);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~WriteLock
+
+Description: Destructor.
+
+Algorithm:   Closing the lock file releases the lock.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Another writer may proceed.
+------------------------------------------------------------------------------*/
+WriteLock :: ~WriteLock()
+{
+   if(fd >= 0)
+      close(fd);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        isHeld
+
+Description: Whether the lock was taken.
+
+Algorithm:   The lock is held while the lock file is open.
+
+Parameters:  none
+
+Output:      true when the caller is the only writer
+
+Result:      Whether the lock is held is returned.
+------------------------------------------------------------------------------*/
+bool WriteLock :: isHeld(void) const
+{
+   /* Return value */
+   return fd >= 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getManifest
+
+Description: Commit record when the lock was taken.
+
+Algorithm:   Returns manifest.
+
+Parameters:  none
+
+Output:      manifest: the commit record
+
+Result:      The commit record is returned.
+------------------------------------------------------------------------------*/
+const Manifest & WriteLock :: getManifest(void) const
+{
+   return manifest;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ReadView
+
+Description: Constructor.
+
+Algorithm:   Reads the commit record and opens the datafile it names. If that
+             file was already reclaimed, or its inode is not the one the record
+             names, a writer replaced the datafile in between and both are taken
+             again. A record that does not know its inode accepts whatever was
+             opened. The committed length is never taken past the end of the
+             file.
+
+Parameters:  none
+
+Output:      none
+
+Result:      A consistent snapshot is pinned.
+------------------------------------------------------------------------------*/
+ReadView :: ReadView() : fd(-1), mapping(NULL)
+{
+   struct stat info; /* size and inode of the opened datafile */
+   Manifest again;   /* commit record read after a failed open */
+
+   for(int attempt = 0; attempt < PIN_ATTEMPTS; attempt++)
+   {
+      readManifest(manifest);
+      fd = open(manifest.file.c_str(), O_RDONLY);
+      if(fd < 0)
+      {
+         /* No datafile and no newer record; the database is empty */
+         readManifest(again);
+         if(again.generation == manifest.generation &&
+            again.file == manifest.file)
+         {
+            manifest.bytes = 0;
+            return;
+         }
+         continue;
+      }
+
+      if(fstat(fd, &info) == 0 &&
+         (manifest.inode == 0 || manifest.inode == info.st_ino ||
+          attempt + 1 == PIN_ATTEMPTS))
+      {
+         if(manifest.bytes < 0 || manifest.bytes > info.st_size)
+            manifest.bytes = info.st_size;
+         return;
+      }
+
+      close(fd);
+      fd = -1;
+      this_thread :: sleep_for(chrono :: microseconds(PIN_WAIT_MICROSECONDS));
+   }
+
+   manifest.bytes = 0;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~ReadView
+
+Description: Destructor.
+
+Algorithm:   Closes the datafile of the pinned generation.
+
+Parameters:  none
+
+Output:      none
+
+Result:      The snapshot is released.
+------------------------------------------------------------------------------*/
+ReadView :: ~ReadView()
+{
+   if(mapping != NULL)
+      munmap(const_cast<char *>(mapping), manifest.bytes);
+   if(fd >= 0)
+      close(fd);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        getManifest
+
+Description: The pinned commit record.
+
+Algorithm:   Returns manifest.
+
+Parameters:  none
+
+Output:      manifest: the commit record
+
+Result:      The commit record is returned.
+------------------------------------------------------------------------------*/
+const Manifest & ReadView :: getManifest(void) const
+{
+   return manifest;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        read
+
+Description: Read the committed part of the datafile.
+
+Algorithm:   Reads the committed bytes of the pinned datafile through the I/O
+             engine. Rows appended after the snapshot was pinned are not read.
+
+Parameters:  none
+
+Output:      content: the datafile as of the snapshot
+
+Result:      The snapshot's contents are returned.
+------------------------------------------------------------------------------*/
+string ReadView :: read(void) const
+{
+   if(fd < 0 || manifest.bytes <= 0)
+      return string();
+
+   /* Return value */
+   return ioEngine().readPrefix(fd, manifest.bytes);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        read
+
+Description: Read part of the committed datafile.
+
+Algorithm:   Clips the range to the committed bytes of the pinned datafile and
+             reads it through the I/O engine.
+
+Parameters:  offset: first byte to read
+             length: amount of bytes to read
+
+Output:      content: the committed bytes of the range
+
+Result:      The range as of the snapshot is returned.
+------------------------------------------------------------------------------*/
+string ReadView :: read(long long offset, size_t length) const
+{
+   if(fd < 0 || offset < 0 || offset >= manifest.bytes)
+      return string();
+
+   if(static_cast<long long>(length) > manifest.bytes - offset)
+      length = manifest.bytes - offset;
+
+   /* Return value */
+   return ioEngine().readRange(fd, offset, length);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        map
+
+Description: The committed part of the datafile in place.
+
+Algorithm:   The committed bytes of the pinned datafile are mapped read only
+             the first time, so rows can be parsed where they lie without
+             copying them. Callers pass over the whole mapping, so the kernel
+             is advised to read it ahead sequentially. Should mapping fail, the
+             bytes are read once instead. The bytes stay valid until the view
+             is destroyed.
+
+Parameters:  none
+
+Output:      content: the datafile as of the snapshot
+
+Result:      The snapshot's contents are returned.
+------------------------------------------------------------------------------*/
+string_view ReadView :: map(void) const
+{
+   void *mapped; /* result of mmap */
+
+   if(fd < 0 || manifest.bytes <= 0)
+      return string_view();
+
+   if(mapping == NULL && loaded.empty())
+   {
+      mapped = mmap(NULL, manifest.bytes, PROT_READ, MAP_SHARED, fd, 0);
+      if(mapped != MAP_FAILED)
+      {
+         mapping = static_cast<const char *>(mapped);
+         madvise(mapped, manifest.bytes, MADV_SEQUENTIAL);
+         madvise(mapped, manifest.bytes, MADV_WILLNEED);
+      }
+      else
+         loaded = read();
+   }
+
+   /* Return value */
+   return mapping != NULL ? string_view(mapping, manifest.bytes) :
+                            string_view(loaded);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        stream
+
+Description: Start a StreamReader on the committed part of the datafile.
+
+Algorithm:   Opens the reader on the pinned datafile from the offset to the
+             end of the committed bytes. The view must outlive the reader.
+
+Parameters:  reader: the reader
+             offset: first byte to read
+
+Output:      true when the reader was started
+
+Result:      The reader reads the snapshot's rows from offset on.
+------------------------------------------------------------------------------*/
+bool ReadView :: stream(StreamReader &reader, long long offset) const
+{
+   if(fd < 0 || offset < 0 || offset > manifest.bytes)
+      return false;
+
+   /* Return value */
+   return reader.open(fd, offset, manifest.bytes);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        Reclaimer
+
+Description: Constructor.
+
+Algorithm:   Makes sure the scheduler exists first, so that it is destroyed
+             after the reclaimer when the program exits.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Reclaimer object is allocated.
+------------------------------------------------------------------------------*/
+Reclaimer :: Reclaimer() : tasks(BACKGROUND), newest(0), isScheduled(false)
+{
+   scheduler();
+}
+
+/*-----------------------------------------------------------------------------
+Name:        ~Reclaimer
+
+Description: Destructor.
+
+Algorithm:   Waits for the removal task to finish what was already retired.
+
+Parameters:  none
+
+Output:      none
+
+Result:      Reclaimer object is deallocated.
+------------------------------------------------------------------------------*/
+Reclaimer :: ~Reclaimer()
+{
+   scheduler().wait(tasks);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        retire
+
+Description: Schedule removal of the generations older than one.
+
+Algorithm:   Records the newest generation whose predecessors may go and
+             submits the removal task unless it is already queued or running.
+             Requests that arrive meanwhile are merged, since removing older
+             than the newest covers them all.
+
+Parameters:  generation: the generation just installed
+
+Output:      void
+
+Result:      The old datafiles will be removed.
+------------------------------------------------------------------------------*/
+void Reclaimer :: retire(long generation)
+{
+   lock_guard<mutex> guard(lock);
+
+   if(generation > newest)
+      newest = generation;
+
+   if(!isScheduled)
+   {
+      isScheduled = true;
+      scheduler().submit(tasks, [this]() { run(); });
+   }
+}
+
+/*-----------------------------------------------------------------------------
+Name:        finish
+
+Description: Wait for every removal scheduled so far.
+
+Algorithm:   Waits on the removal task, helping to run it. Needed before the
+             working directory changes, since files are removed by name.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Retired datafiles are removed.
+------------------------------------------------------------------------------*/
+void Reclaimer :: finish(void)
+{
+   scheduler().wait(tasks);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        run
+
+Description: Body of the removal task.
+
+Algorithm:   Takes the retired generation and sweeps without holding the lock,
+             until nothing more was retired meanwhile.
+
+Parameters:  none
+
+Output:      void
+
+Result:      Retired datafiles are removed.
+------------------------------------------------------------------------------*/
+void Reclaimer :: run(void)
+{
+   unique_lock<mutex> guard(lock);
+
+   while(newest > 0)
+   {
+      long generation = newest; /* sweep everything older than this */
+      newest = 0;
+
+      guard.unlock();
+      sweep(generation);
+      guard.lock();
+   }
+
+   isScheduled = false;
+}
+
+/*-----------------------------------------------------------------------------
+Name:        sweep
+
+Description: Remove the datafiles older than a generation.
+
+Algorithm:   Scans the working directory for DATA_FILE, which only ever holds
+             the first generation, and for generation files numbered below
+             generation, and unlinks them. Files of newer generations installed
+             meanwhile, by this process or another, are never touched. Files a
+             crash left behind are removed by the next sweep.
+
+Parameters:  generation: the oldest generation to keep
+
+Output:      void
+
+Result:      Only generation and newer remain on disk.
+------------------------------------------------------------------------------*/
+void Reclaimer :: sweep(long generation)
+{
+   const size_t PREFIX_LENGTH = strlen(DATA_FILE_PREFIX);
+   const size_t SUFFIX_LENGTH = strlen(DATA_FILE_SUFFIX);
+   DIR *directory = opendir("."); /* the working directory */
+   struct dirent *entry;          /* file being considered */
+
+   if(directory == NULL)
+      return;
+
+   while((entry = readdir(directory)) != NULL)
+   {
+      const char *name = entry->d_name;
+      size_t length = strlen(name);
+
+      if(strcmp(name, DATA_FILE) == 0)
+      {
+         unlink(name);
+         continue;
+      }
+
+      if(length <= PREFIX_LENGTH + SUFFIX_LENGTH ||
+         strncmp(name, DATA_FILE_PREFIX, PREFIX_LENGTH) != 0 ||
+         strcmp(name + length - SUFFIX_LENGTH, DATA_FILE_SUFFIX) != 0)
+         continue;
+
+      /* The part between prefix and suffix must be a generation number */
+      string number(name + PREFIX_LENGTH,
+                    length - PREFIX_LENGTH - SUFFIX_LENGTH);
+      if(number.find_first_not_of("0123456789") != string :: npos)
+         continue;
+
+      if(stol(number) < generation)
+         unlink(name);
+   }
+
+   closedir(directory);
+}
+
+/*-----------------------------------------------------------------------------
+Name:        reclaimer
+
+Description: Reclaimer shared by the whole program.
+
+Algorithm:   Constructs the reclaimer the first time it is asked for; it is
+             destroyed, after finishing its work, when the program exits.
+
+Parameters:  none
+
+Output:      reclaimer: the shared reclaimer
+
+Result:      The shared reclaimer is returned.
+------------------------------------------------------------------------------*/
+Reclaimer & reclaimer(void)
+{
+   static Reclaimer shared;
+
+   return shared;
+}
@@ -0,0 +1,208 @@
+/*#############################################################################
+Author: Jeremy Cruz
+
+Date:   10/19/2026
+
+File :  Version.h
+
+------------------------------------------------------------------------------
+Description: This is a header file containing the definitions used to give
+             readers consistent snapshots of the database while it is being
+             written. The occupancy file is the commit record of the database:
+             besides the occupancy it holds the generation of the datafile, how
+             many of its bytes are committed and which file the generation
+             lives in. Every generation has a file of its own, so replacing the
+             database only switches the record to a new file; old files are
+             removed in the background. Writers take a lock and replace the
+             commit record atomically; readers take no lock at all.
+#############################################################################*/
+#ifndef VERSION_H
+#define VERSION_H
+
+#include<string>
+#include<string_view>
+#include<mutex>
+#include<sys/types.h>
+#include "Scheduler.h"
+#include "AsyncIO.h"
+
+using namespace std;
+
+/* Files holding the database; generations after the first are held in
+   files named DATA_FILE_PREFIX, the generation and DATA_FILE_SUFFIX */
+static const char DATA_FILE[] = "DataFile.txt";
+static const char DATA_FILE_PREFIX[] = "DataFile.";
+static const char DATA_FILE_SUFFIX[] = ".txt";
+static const char OCCUPANCY_FILE[] = "Occupancy.txt";
+static const char LOCK_FILE[] = "DataFile.lock";
+static const char LOAD_SUFFIX[] = ".load";
+
+/*=============================================================================
+Struct:      Manifest
+
+Description: The commit record of the database.
+
+DataFields:  occupancy:  amount of clients committed
+             generation: incremented each time the datafile is replaced
+             bytes:      committed length of the datafile; -1 if unknown
+             inode:      inode of the datafile of this generation; 0 if unknown
+             file:       datafile of this generation
+=============================================================================*/
+struct Manifest
+{
+   int occupancy;
+   long generation;
+   long long bytes;
+   unsigned long inode;
+   string file;
+};
+
+/* Read and atomically replace the commit record */
+bool readManifest(Manifest &);
+bool publishManifest(const Manifest &, bool);
+
+/* Commit rows appended to the datafile, and flush those commits to the
+   device */
+bool commitAppend(int);
+bool syncCommits(void);
+
+/* Make a fully written file the next generation of the datafile */
+string generationFile(long);
+bool installGeneration(const string &, int);
+
+/* File a load writes the next datafile to, and removal of those left behind
+   by loads that never finished */
+string loadFile(void);
+void sweepLoads(void);
+
+/*=============================================================================
+Class:       Reclaimer
+
+Description: Removes the datafiles of replaced generations as a background
+             task of the scheduler, so a reset or load never waits for the file
+             system to free a large file and lookups running meanwhile keep
+             their priority. Readers still holding an old datafile open keep
+             reading it; its space is freed when they close it.
+
+DataFields:  tasks:       the removal task
+             lock:        guards newest and isScheduled
+             newest:      generations older than this are removed; 0 if none
+             isScheduled: whether the removal task is queued or running
+
+Functions:   Reclaimer:  constructor
+             ~Reclaimer: destructor; waits for pending removals
+             retire:     schedule removal of generations older than one
+             finish:     wait for every removal scheduled so far
+             run:        body of the removal task
+             sweep:      remove the datafiles older than a generation
+=============================================================================*/
+class Reclaimer
+{
+   private:
+      TaskGroup tasks;
+      mutex lock;
+      long newest;
+      bool isScheduled;
+
+      /* Not copyable */
+      Reclaimer(const Reclaimer &);
+      Reclaimer & operator=(const Reclaimer &);
+
+      void run(void);
+      static void sweep(long);
+
+   public:
+      Reclaimer();
+      ~Reclaimer();
+
+      void retire(long);
+      void finish(void);
+};
+
+/* Reclaimer shared by the whole program */
+Reclaimer & reclaimer(void);
+
+/*=============================================================================
+Class:       WriteLock
+
+Description: Serializes writers of the database, across processes as well as
+             threads. While it is held the commit record cannot change under
+             the holder. Taking the lock also drops any bytes a writer appended
+             but never committed, such as after a crash. When the lock file
+             cannot be opened or locked the lock is not held, and the caller
+             must not write.
+
+DataFields:  fd:       the locked file; -1 when the lock is not held
+             manifest: commit record when the lock was taken
+
+Functions:   WriteLock:   constructor; waits for and takes the lock
+             ~WriteLock:  destructor; releases the lock
+             isHeld:      whether the lock was taken
+             getManifest: commit record when the lock was taken
+=============================================================================*/
+class WriteLock
+{
+   private:
+      int fd;
+      Manifest manifest;
+
+      /* Not copyable */
+      WriteLock(const WriteLock &);
+      WriteLock & operator=(const WriteLock &);
+
+   public:
+      WriteLock();
+      ~WriteLock();
+
+      bool isHeld(void) const;
+      const Manifest & getManifest(void) const;
+};
+
+/*=============================================================================
+Class:       ReadView
+
+Description: A pinned snapshot of the database. It holds the commit record and
+             an open descriptor of the datafile of that generation, so only
+             committed rows are read and a reset or load that replaces the
+             datafile afterwards does not affect it.
+
+DataFields:  fd:       datafile of the pinned generation
+             manifest: the pinned commit record
+             mapping:  the committed bytes mapped into memory; NULL before map
+                       is called or when mapping failed
+             loaded:   the committed bytes read instead when mapping failed
+
+Functions:   ReadView:    constructor; pins the current snapshot
+             ~ReadView:   destructor; releases the snapshot and its mapping
+             getManifest: the pinned commit record
+             read:        read the committed part of the datafile, or a range
+                          of it
+             map:         the committed part of the datafile in place, valid
+                          while the view is
+             stream:      start a StreamReader on the committed part of the
+                          datafile from an offset
+=============================================================================*/
+class ReadView
+{
+   private:
+      int fd;
+      Manifest manifest;
+      mutable const char *mapping;
+      mutable string loaded;
+
+      /* Not copyable */
+      ReadView(const ReadView &);
+      ReadView & operator=(const ReadView &);
+
+   public:
+      ReadView();
+      ~ReadView();
+
+      const Manifest & getManifest(void) const;
+      string read(void) const;
+      string read(long long, size_t) const;
+      string_view map(void) const;
+      bool stream(StreamReader &, long long) const;
+};
+
+#endif